@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -71,7 +73,9 @@ struct channel {
 	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
-	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	struct semaphore completion_wait;   /* Up'd by disk_softirq(). */
+	unsigned completions;       /* Interrupts not yet passed to
+								   completion_wait. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -95,12 +99,14 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static softirq_func disk_softirq;
 
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) {
 	size_t chan_no;
 
+	softirq_register (SOFTIRQ_DISK, disk_softirq, "disk");
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -122,6 +128,7 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		c->completions = 0;
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -210,12 +217,14 @@ disk_size (struct disk *d) {
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	struct channel *c;
+	uint64_t start;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
 	lock_acquire (&c->lock);
+	start = rdtsc ();
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
 	sema_down (&c->completion_wait);
@@ -223,6 +232,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
 	input_sector (c, buffer);
 	d->read_cnt++;
+	TRACE (TRACE_DISK_READ, sec_no, rdtsc () - start);
 	lock_release (&c->lock);
 }
 
@@ -234,12 +244,14 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	struct channel *c;
+	uint64_t start;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
 	lock_acquire (&c->lock);
+	start = rdtsc ();
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
 	if (!wait_while_busy (d))
@@ -247,6 +259,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	output_sector (c, buffer);
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
+	TRACE (TRACE_DISK_WRITE, sec_no, rdtsc () - start);
 	lock_release (&c->lock);
 }
 
@@ -520,7 +533,8 @@ interrupt_handler (struct intr_frame *f) {
 		if (f->vec_no == c->irq) {
 			if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
-				sema_up (&c->completion_wait);      /* Wake up waiter. */
+				c->completions++;                   /* Wake up waiter later. */
+				softirq_raise (SOFTIRQ_DISK);
 			} else
 				printf ("%s: unexpected interrupt\n", c->name);
 			return;
@@ -529,6 +543,23 @@ interrupt_handler (struct intr_frame *f) {
 	NOT_REACHED ();
 }
 
+/* Disk softirq.  Wakes up the threads waiting for the
+   completions acknowledged by interrupt_handler(). */
+static void
+disk_softirq (void) {
+	struct channel *c;
+
+	for (c = channels; c < channels + CHANNEL_CNT; c++) {
+		enum intr_level old_level = intr_disable ();
+		unsigned completions = c->completions;
+
+		c->completions = 0;
+		intr_set_level (old_level);
+		while (completions-- > 0)
+			sema_up (&c->completion_wait);
+	}
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
@@ -38,6 +38,32 @@ input_getc (void) {
 	return key;
 }
 
+/* Retrieves a key from the input buffer, like input_getc(), but
+   gives up waiting and returns -1 once *STOP is true and
+   input_wake() is called. */
+int
+input_getc_unless (const bool *stop) {
+	enum intr_level old_level;
+	uint8_t key;
+	bool got;
+
+	old_level = intr_disable ();
+	got = intq_getc_unless (&buffer, stop, &key);
+	if (got)
+		serial_notify ();
+	intr_set_level (old_level);
+
+	return got ? key : -1;
+}
+
+/* Wakes up the thread waiting for a key, if any, to have it
+   check its stop condition.  Interrupts must be off. */
+void
+input_wake (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	intq_wake (&buffer);
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
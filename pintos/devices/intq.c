@@ -50,6 +50,25 @@ intq_getc (struct intq *q) {
 	return byte;
 }
 
+/* Like intq_getc(), but gives up waiting for a byte and returns
+   false once *STOP is true and intq_wake() is called.  Otherwise
+   removes a byte from Q, stores it in *BYTE and returns true. */
+bool
+intq_getc_unless (struct intq *q, const bool *stop, uint8_t *byte) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	while (intq_empty (q)) {
+		ASSERT (!intr_context ());
+		if (*stop)
+			return false;
+		lock_acquire (&q->lock);
+		if (intq_empty (q) && !*stop)
+			wait (q, &q->not_empty);
+		lock_release (&q->lock);
+	}
+	*byte = intq_getc (q);
+	return true;
+}
+
 /* Adds BYTE to the end of Q.
    Q must not be full if called from an interrupt handler.
    Otherwise, if Q is full, first sleeps until a byte is
@@ -69,6 +88,17 @@ intq_putc (struct intq *q, uint8_t byte) {
 	signal (q, &q->not_empty);
 }
 
+/* Wakes up the thread waiting for Q to become non-empty, if any,
+   to have it check its stop condition, see intq_getc_unless(). */
+void
+intq_wake (struct intq *q) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (q->not_empty != NULL) {
+		thread_unblock (q->not_empty);
+		q->not_empty = NULL;
+	}
+}
+
 /* Returns the position after POS within an intq. */
 static int
 next (int pos) {
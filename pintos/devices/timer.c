@@ -5,8 +5,10 @@
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -21,14 +23,73 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* 8254 input frequency and the count that spans one tick. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* If false (default), the PIT interrupts TIMER_FREQ times per
+   second at all times.
+   If true, the idle thread switches the PIT to one-shot mode up to
+   the next timer event and the skipped ticks are caught up when
+   the CPU wakes.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Tickless idle state.  While armed, the PIT counts ONESHOT_COUNT
+   down in one-shot mode; ONESHOT_BASE counts of the current tick
+   had already elapsed when it was armed, so its expiry lands
+   exactly ONESHOT_TICKS tick boundaries later. */
+static bool oneshot_armed;
+static int64_t oneshot_ticks;
+static unsigned oneshot_base;
+static unsigned oneshot_count;
+static int64_t tickless_ticks;  /* # of ticks caught up after idling. */
+
+/* TSC clock source.  The TSC is calibrated against the PIT by
+   timer_calibrate(); until then TSC_HZ is 0 and time advances
+   only a tick at a time. */
+#define NS_PER_SEC 1000000000
+#define NS_PER_TICK (NS_PER_SEC / TIMER_FREQ)
+#define CALIBRATE_TICKS (TIMER_FREQ / 10)
+static uint64_t tsc_hz;         /* TSC cycles per second. */
+static uint64_t tsc_boot;       /* TSC at tick 0. */
+static uint64_t tick_tsc;       /* TSC at the start of the current tick. */
+
+/* Hierarchical timing wheel of pending timer events.
+   Level L has WHEEL_SLOTS slots that each span WHEEL_SLOTS^L
+   ticks, so an event is filed in O(1) by how far away its expiry
+   is.  Whenever the lower level wraps around, the matching slot of
+   the next level is cascaded down, so each event is moved at most
+   WHEEL_LEVELS times before it fires.  Events beyond the reach of
+   the top level wait on wheel_overflow. */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static struct list wheel_overflow;
+static int64_t wheel_clock;     /* Last tick whose events were run. */
+
+/* MLFQS seconds whose recalculation is left to timer_softirq(). */
+static int mlfqs_seconds;
+
+/* Statistics. */
+static uint64_t wheel_cycles;   /* TSC cycles spent running the wheel. */
+static uint64_t wheel_max_cycles; /* Longest single run of the wheel. */
+static int64_t wheel_fired;     /* # of events fired. */
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static softirq_func timer_softirq;
 static void real_time_sleep (int64_t num, int32_t denom);
+static void wheel_insert (struct timer_event *);
+static void wheel_cascade (struct list *);
+static void wheel_advance (int64_t now);
+static int64_t wheel_next_expiry (int64_t limit);
+static void timer_tick_once (bool user);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (unsigned count);
+static unsigned pit_read (void);
+static bool pit_irq_pending (void);
 
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -36,40 +97,48 @@ static void real_time_sleep (int64_t num, int32_t denom);
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_set_periodic ();
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	for (int level = 0; level < WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+			list_init (&wheel[level][slot]);
+	list_init (&wheel_overflow);
+	wheel_clock = 0;
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	softirq_register (SOFTIRQ_TIMER, timer_softirq, "timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC clock source by counting TSC cycles over
+   CALIBRATE_TICKS timer ticks. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	enum intr_level old_level;
+	int64_t start;
+	uint64_t start_tsc;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Start on a tick boundary. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	old_level = intr_disable ();
+	start = ticks;
+	start_tsc = tick_tsc;
+	intr_set_level (old_level);
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	while (ticks < start + CALIBRATE_TICKS)
+		barrier ();
+
+	old_level = intr_disable ();
+	tsc_hz = (tick_tsc - start_tsc) * TIMER_FREQ / (ticks - start);
+	tsc_boot = tick_tsc - ticks * (tsc_hz / TIMER_FREQ);
+	intr_set_level (old_level);
+
+	printf ("%'"PRIu64" TSC cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -89,6 +158,31 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  Before
+   timer_calibrate() this only advances once per tick. */
+int64_t
+timer_ns (void) {
+	if (tsc_hz == 0)
+		return timer_ticks () * NS_PER_TICK;
+	return timer_cycles_to_ns (rdtsc () - tsc_boot);
+}
+
+/* Converts CYCLES of the TSC to nanoseconds.  Returns 0 before
+   timer_calibrate(). */
+int64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	if (tsc_hz == 0)
+		return 0;
+	return cycles / tsc_hz * NS_PER_SEC
+		+ cycles % tsc_hz * NS_PER_SEC / tsc_hz;
+}
+
+/* Returns the TSC frequency in Hz, or 0 before timer_calibrate(). */
+uint64_t
+timer_tsc_hz (void) {
+	return tsc_hz;
+}
+
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t durations) {
@@ -115,85 +209,329 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Initializes timer event E to call FUNC with AUX on expiry. */
+void
+timer_event_init (struct timer_event *e, timer_event_func *func, void *aux) {
+	ASSERT (e != NULL);
+	ASSERT (func != NULL);
+
+	e->expires = 0;
+	e->pending = false;
+	e->func = func;
+	e->aux = aux;
+}
+
+/* Files timer event E to fire at tick EXPIRES.  An expiry that
+   has already passed fires on the next tick.  E must not already
+   be pending.  Takes constant time. */
+void
+timer_event_add (struct timer_event *e, int64_t expires) {
+	enum intr_level old_level;
+
+	ASSERT (e != NULL);
+	ASSERT (!e->pending);
+
+	old_level = intr_disable ();
+	e->expires = expires > wheel_clock ? expires : wheel_clock + 1;
+	e->pending = true;
+	wheel_insert (e);
+	intr_set_level (old_level);
+}
+
+/* Withdraws timer event E if it has not fired yet.  Takes
+   constant time. */
+void
+timer_event_cancel (struct timer_event *e) {
+	enum intr_level old_level;
+
+	ASSERT (e != NULL);
+
+	old_level = intr_disable ();
+	if (e->pending) {
+		list_remove (&e->elem);
+		e->pending = false;
+	}
+	intr_set_level (old_level);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	printf ("Timer: %"PRId64" events fired, %"PRIu64" cycles in wheel "
+			"(max %"PRIu64")\n", wheel_fired, wheel_cycles, wheel_max_cycles);
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" ticks caught up after tickless idle\n",
+				tickless_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, right before it
+   halts.  In tickless mode, stops the periodic tick and programs
+   the PIT to interrupt at the tick of the next timer event, as far
+   out as the 16-bit counter allows. */
+void
+timer_idle_enter (void) {
+	unsigned base;
+	int64_t n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || oneshot_armed)
+		return;
+
+	/* A tick that is already latched would be mistaken for the
+	   one-shot expiry. */
+	if (pit_irq_pending ())
+		return;
+
+	base = PIT_TICK_COUNT - pit_read ();
+	n = wheel_next_expiry ((0xffff + base) / PIT_TICK_COUNT) - ticks;
+	if (n < 2)
+		return;
+
+	oneshot_armed = true;
+	oneshot_ticks = n;
+	oneshot_base = base;
+	oneshot_count = n * PIT_TICK_COUNT - base;
+	pit_set_oneshot (oneshot_count);
+}
+
+/* Called from an external interrupt other than the timer's.  If
+   that interrupt cut a tickless idle period short, catches the
+   tick counter up to the current time and arms the PIT for the
+   rest of the current tick, after which the periodic tick
+   resumes. */
+void
+timer_idle_exit (void) {
+	unsigned remaining, total;
+	int64_t n;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!oneshot_armed)
+		return;
+
+	/* Once the one-shot has expired the counter wraps around, and
+	   the pending timer interrupt does the catching up. */
+	remaining = pit_read ();
+	if (remaining > oneshot_count || pit_irq_pending ())
+		return;
+
+	total = oneshot_base + (oneshot_count - remaining);
+	tick_tsc = rdtsc () - (uint64_t) (total % PIT_TICK_COUNT) * tsc_hz / PIT_HZ;
+	n = total / PIT_TICK_COUNT;
+	tickless_ticks += n;
+	while (n-- > 0)
+		timer_tick_once (false);
+	softirq_raise (SOFTIRQ_TIMER);
+
+	oneshot_ticks = 1;
+	oneshot_base = total % PIT_TICK_COUNT;
+	oneshot_count = PIT_TICK_COUNT - oneshot_base;
+	pit_set_oneshot (oneshot_count);
+}
+
+/* Puts pending event E into the wheel slot covering its expiry,
+   which must not be earlier than wheel_clock. */
+static void
+wheel_insert (struct timer_event *e) {
+	int64_t delta = e->expires - wheel_clock;
+	int level;
+
+	ASSERT (delta >= 0);
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1))) {
+			int slot = (e->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+			list_push_back (&wheel[level][slot], &e->elem);
+			return;
+		}
+	list_push_back (&wheel_overflow, &e->elem);
+}
+
+/* Re-files every event of SLOT relative to the current
+   wheel_clock, which moves it down at least one level. */
+static void
+wheel_cascade (struct list *slot) {
+	struct list events;
+
+	list_init (&events);
+	while (!list_empty (slot))
+		list_push_back (&events, list_pop_front (slot));
+	while (!list_empty (&events))
+		wheel_insert (list_entry (list_pop_front (&events),
+					struct timer_event, elem));
+}
+
+/* Returns the first tick after wheel_clock, but no more than LIMIT
+   ticks after it, at which the wheel has to run: either a level-0
+   slot holds an event or the higher levels cascade. */
+static int64_t
+wheel_next_expiry (int64_t limit) {
+	int64_t t;
+
+	for (t = wheel_clock + 1; t < wheel_clock + limit; t++)
+		if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+			break;
+	return t;
+}
+
+/* Runs the wheel one tick at a time up to NOW, firing every
+   event whose expiry has been reached.  Called only from
+   timer_softirq(), so interrupts are let in between events. */
+static void
+wheel_advance (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (wheel_clock < now) {
+		struct list *slot;
+		int level;
+
+		wheel_clock++;
+
+		/* Cascade each level whose lower neighbor just wrapped. */
+		for (level = 1; level < WHEEL_LEVELS; level++) {
+			if ((wheel_clock & (((int64_t) 1 << (WHEEL_BITS * level)) - 1)) != 0)
+				break;
+			wheel_cascade (&wheel[level][(wheel_clock >> (WHEEL_BITS * level))
+					& WHEEL_MASK]);
+		}
+		if (level == WHEEL_LEVELS)
+			wheel_cascade (&wheel_overflow);
+
+		slot = &wheel[0][wheel_clock & WHEEL_MASK];
+		while (!list_empty (slot)) {
+			struct timer_event *e = list_entry (list_pop_front (slot),
+					struct timer_event, elem);
+			ASSERT (e->expires == wheel_clock);
+			e->pending = false;
+			wheel_fired++;
+			e->func (e->aux);
+			intr_enable ();
+			intr_disable ();
+		}
+	}
 }
 
-/* Timer interrupt handler. */
+/* Advances the tick counter by one and does the per-tick
+   scheduler bookkeeping that cannot wait for timer_softirq().
+   USER is true if the tick interrupted user mode. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_tick_once (bool user) {
 	ticks++;
-	thread_tick (); 
-	int64_t global_ticks = timer_ticks ();
+	thread_tick (user);
 	struct thread * curr = thread_current();
 	if(thread_mlfqs){
 		if (!is_idle()) curr->recent_cpu+= c2f(1) ;
 		if (timer_ticks () % 4 == 0) {
-			if (timer_ticks () % TIMER_FREQ == 0){
-				mlfqs_update_load_avg();
-				mlfqs_update_all_thread();
-			}
+			if (timer_ticks () % TIMER_FREQ == 0)
+				mlfqs_seconds++;
 			mlfqs_update_priority(curr); 
 		}
 	}
-	thread_wakeup(global_ticks);
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+/* Timer interrupt handler. */
+static void
+timer_interrupt (struct intr_frame *args) {
+	tick_tsc = rdtsc ();
+	if (oneshot_armed) {
+		/* End of a tickless idle period: it ended on a tick
+		   boundary, so the periodic tick resumes in phase. */
+		oneshot_armed = false;
+		pit_set_periodic ();
+		tickless_ticks += oneshot_ticks;
+		while (oneshot_ticks-- > 0)
+			timer_tick_once (false);
+	} else
+		timer_tick_once (args->cs == SEL_UCSEG);
+	softirq_raise (SOFTIRQ_TIMER);
+}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Timer softirq.  Does the MLFQS recalculation that is due once
+   per second, then fires expired timer events.  The recalculation
+   comes first, as it did in the interrupt handler, so that
+   load_avg does not count the threads woken on a second boundary
+   and those threads are given priorities for the new second. */
+static void
+timer_softirq (void) {
+	uint64_t start, cycles;
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	intr_disable ();
+	for (; mlfqs_seconds > 0; mlfqs_seconds--) {
+		mlfqs_update_load_avg ();
+		mlfqs_update_all_thread ();
+	}
+
+	start = rdtsc ();
+	wheel_advance (ticks);
+	cycles = rdtsc () - start;
+	wheel_cycles += cycles;
+	if (cycles > wheel_max_cycles)
+		wheel_max_cycles = cycles;
+	intr_enable ();
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Sets up the PIT to interrupt TIMER_FREQ times per second. */
+static void
+pit_set_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, PIT_TICK_COUNT & 0xff);
+	outb (0x40, PIT_TICK_COUNT >> 8);
+}
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+/* Sets up the PIT to interrupt once, COUNT input cycles from now. */
+static void
+pit_set_oneshot (unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current value of the PIT's counter 0. */
+static unsigned
+pit_read (void) {
+	unsigned lo, hi;
+
+	outb (0x43, 0x00);    /* CW: counter 0, latch count. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return (hi << 8) | lo;
+}
+
+/* Returns true if the PIC has latched a timer interrupt that the
+   CPU has not taken yet. */
+static bool
+pit_irq_pending (void) {
+	outb (0x20, 0x0a);    /* OCW3: read interrupt request register. */
+	return (inb (0x20) & 0x01) != 0;
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
+/* Sleep for approximately NUM/DENOM seconds.  Blocks until the
+   last tick boundary before the deadline, which yields the CPU to
+   other threads, then spins on the TSC for the part of a tick
+   that is left. */
 static void
 real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
-
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
+	enum intr_level old_level;
+	int64_t deadline, tick, tick_ns, n;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other
-		   processes. */
-		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
-	}
+	ASSERT (NS_PER_SEC % denom == 0);
+	if (num <= 0)
+		return;
+	deadline = timer_ns () + num * (NS_PER_SEC / denom);
+
+	/* Tick boundaries are N * NS_PER_TICK after the start of the
+	   current tick. */
+	old_level = intr_disable ();
+	tick = ticks;
+	tick_ns = tsc_hz != 0 ? timer_cycles_to_ns (tick_tsc - tsc_boot)
+		: tick * NS_PER_TICK;
+	intr_set_level (old_level);
+
+	n = (deadline - tick_ns) / NS_PER_TICK;
+	if (n > 0 && tick + n > timer_ticks ())
+		thread_sleep (tick + n);
+
+	while (timer_ns () < deadline)
+		barrier ();
 }
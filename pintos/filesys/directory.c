@@ -5,6 +5,7 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
@@ -75,7 +76,8 @@ dir_get_inode (struct dir *dir) {
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
  * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
+ * otherwise, returns false and ignores EP and OFSP.
+ * The caller must hold DIR's inode lock. */
 static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
@@ -104,12 +106,20 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	struct rwlock *rw;
+	struct rwlock_hold hold;
 	struct dir_entry e;
+	bool found;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
+	rw = inode_rw_lock (dir->inode);
+	rwlock_acquire_read (rw, &hold);
+	found = lookup (dir, name, &e, NULL);
+	rwlock_release_read (rw);
+
+	if (found)
 		*inode = inode_open (e.inode_sector);
 	else
 		*inode = NULL;
@@ -125,6 +135,7 @@ dir_lookup (const struct dir *dir, const char *name,
  * error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+	struct rwlock *rw;
 	struct dir_entry e;
 	off_t ofs;
 	bool success = false;
@@ -136,6 +147,11 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
+	/* Hold the directory from the check to the write, so that
+	 * two threads cannot add the same name. */
+	rw = inode_rw_lock (dir->inode);
+	rwlock_acquire_write (rw);
+
 	/* Check that NAME is not in use. */
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
@@ -159,6 +175,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
 done:
+	rwlock_release_write (rw);
 	return success;
 }
 
@@ -167,6 +184,7 @@ done:
  * which occurs only if there is no file with the given NAME. */
 bool
 dir_remove (struct dir *dir, const char *name) {
+	struct rwlock *rw;
 	struct dir_entry e;
 	struct inode *inode = NULL;
 	bool success = false;
@@ -175,6 +193,9 @@ dir_remove (struct dir *dir, const char *name) {
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	rw = inode_rw_lock (dir->inode);
+	rwlock_acquire_write (rw);
+
 	/* Find directory entry. */
 	if (!lookup (dir, name, &e, &ofs))
 		goto done;
@@ -194,6 +215,7 @@ dir_remove (struct dir *dir, const char *name) {
 	success = true;
 
 done:
+	rwlock_release_write (rw);
 	inode_close (inode);
 	return success;
 }
@@ -203,15 +225,21 @@ done:
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	struct rwlock *rw = inode_rw_lock (dir->inode);
+	struct rwlock_hold hold;
 	struct dir_entry e;
+	bool found = false;
 
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
+	rwlock_acquire_read (rw, &hold);
+	while (!found
+			&& inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+			found = true;
 		}
 	}
-	return false;
+	rwlock_release_read (rw);
+	return found;
 }
 
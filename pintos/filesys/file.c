@@ -158,7 +158,7 @@ file_tell (struct file *file) {
 }
 
 /* get addr of inode's rw_lock */
-struct lock *
+struct rwlock *
 file_rw_lock (struct file *file) {
 	return inode_rw_lock (file->inode);
 }
@@ -5,6 +5,7 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 //
 #include "threads/synch.h"
@@ -26,7 +27,7 @@ struct inode {
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
-	struct lock rw_lock;				/* Synchronize read and write */
+	struct rwlock rw_lock;				/* Synchronize read and write */
 };
 
 /* Identifies an inode. */
@@ -54,13 +55,32 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Lookups share
+ * open_inodes_lock; adding or removing an inode takes it for
+ * writing. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	rwlock_init (&open_inodes_lock);
+}
+
+/* Returns the open inode for SECTOR, reopened, or a null pointer
+ * if SECTOR is not open.  open_inodes_lock must be held. */
+static struct inode *
+find_open_inode (disk_sector_t sector) {
+	struct list_elem *e;
+
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector)
+			return inode_reopen (inode);
+	}
+	return NULL;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -105,40 +125,51 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct inode *inode, *found;
+	struct rwlock_hold hold;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
-	}
+	rwlock_acquire_read (&open_inodes_lock, &hold);
+	inode = find_open_inode (sector);
+	rwlock_release_read (&open_inodes_lock);
+	if (inode != NULL)
+		return inode;
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
 	if (inode == NULL)
 		return NULL;
 
+	/* Another thread may have opened it in the meantime. */
+	rwlock_acquire_write (&open_inodes_lock);
+	found = find_open_inode (sector);
+	if (found != NULL) {
+		rwlock_release_write (&open_inodes_lock);
+		free (inode);
+		return found;
+	}
+
 	/* Initialize. */
 	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	lock_init(&inode->rw_lock);
+	rwlock_init (&inode->rw_lock);
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	rwlock_release_write (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		/* Lookups reopen under a shared open_inodes_lock. */
+		enum intr_level old_level = intr_disable ();
 		inode->open_cnt++;
+		intr_set_level (old_level);
+	}
 	return inode;
 }
 
@@ -153,15 +184,25 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	enum intr_level old_level;
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
-	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	/* Holding open_inodes_lock for writing keeps lookups from
+	 * reviving INODE once its count drops to zero. */
+	rwlock_acquire_write (&open_inodes_lock);
+	old_level = intr_disable ();
+	last = --inode->open_cnt == 0;
+	intr_set_level (old_level);
+	if (last)
 		list_remove (&inode->elem);
+	rwlock_release_write (&open_inodes_lock);
 
+	/* Release resources if this was the last opener. */
+	if (last) {
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
 			free_map_release (inode->sector, 1);
@@ -189,7 +230,13 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
 	uint8_t *bounce = NULL;
+	struct rwlock_hold hold;
+	/* A directory operation may already hold the lock. */
+	bool locked = !rwlock_held_for_read (&inode->rw_lock)
+		&& !rwlock_held_for_write (&inode->rw_lock);
 
+	if (locked)
+		rwlock_acquire_read (&inode->rw_lock, &hold);
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -225,6 +272,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
+	if (locked)
+		rwlock_release_read (&inode->rw_lock);
 	free (bounce);
 
 	return bytes_read;
@@ -241,10 +290,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
+	/* A directory operation may already hold the lock. */
+	bool locked = !rwlock_held_for_write (&inode->rw_lock);
 
 	if (inode->deny_write_cnt)
 		return 0;
 
+	if (locked)
+		rwlock_acquire_write (&inode->rw_lock);
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -287,6 +340,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
+	if (locked)
+		rwlock_release_write (&inode->rw_lock);
 	free (bounce);
 
 	return bytes_written;
@@ -317,8 +372,10 @@ inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
 
-/* get addr of inode's rw_lock */
-struct lock *
+/* get addr of inode's rw_lock.  inode_read_at() holds it for
+ * reading and inode_write_at() for writing, unless the caller
+ * already does. */
+struct rwlock *
 inode_rw_lock (const struct inode *inode) {
 	return &inode->rw_lock;
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 void input_init (void);
 void input_putc (uint8_t);
 uint8_t input_getc (void);
+int input_getc_unless (const bool *stop);
+void input_wake (void);
 bool input_full (void);
 bool buffer_empty(void);
 
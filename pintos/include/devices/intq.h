@@ -37,6 +37,8 @@ void intq_init (struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
+bool intq_getc_unless (struct intq *, const bool *stop, uint8_t *);
 void intq_putc (struct intq *, uint8_t);
+void intq_wake (struct intq *);
 
 #endif /* devices/intq.h */
@@ -1,23 +1,51 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Function called when a timer event expires.  Runs in the timer
+   softirq with interrupts off, so it must not sleep. */
+typedef void timer_event_func (void *aux);
+
+/* A one-shot event filed in the timer wheel. */
+struct timer_event {
+	int64_t expires;            /* Tick at which the event fires. */
+	bool pending;               /* Filed in the wheel? */
+	timer_event_func *func;     /* Called on expiry. */
+	void *aux;                  /* Argument to FUNC. */
+	struct list_elem elem;      /* Wheel slot list element. */
+};
+
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+int64_t timer_ns (void);
+int64_t timer_cycles_to_ns (uint64_t cycles);
+uint64_t timer_tsc_hz (void);
+
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_event_init (struct timer_event *, timer_event_func *, void *aux);
+void timer_event_add (struct timer_event *, int64_t expires);
+void timer_event_cancel (struct timer_event *);
+
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -37,6 +37,6 @@ off_t file_tell (struct file *);
 off_t file_length (struct file *);
 
 
-struct lock * file_rw_lock (struct file *);
+struct rwlock * file_rw_lock (struct file *);
 
 #endif /* filesys/file.h */
@@ -20,5 +20,5 @@ void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 
-struct lock * inode_rw_lock (const struct inode *);
+struct rwlock * inode_rw_lock (const struct inode *);
 #endif /* filesys/inode.h */
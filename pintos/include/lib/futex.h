@@ -0,0 +1,8 @@
+#ifndef __LIB_FUTEX_H
+#define __LIB_FUTEX_H
+
+/* Operations of the futex() system call. */
+#define FUTEX_WAIT 0            /* Sleep if *UADDR == VAL. */
+#define FUTEX_WAKE 1            /* Wake up to VAL waiters on UADDR. */
+
+#endif /* lib/futex.h */
@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Binary min-heap.
+ *
+ * Like lists and hash tables, heaps do not use dynamic
+ * allocation.  Each structure that can potentially be in a heap
+ * embeds a struct heap_elem member, and heap_entry converts a
+ * struct heap_elem back to the structure that contains it.
+ *
+ * The heap is a complete binary tree linked through the
+ * elements themselves rather than stored in an array, so it has
+ * no capacity limit and can be used with interrupts disabled.
+ * heap_insert, heap_pop_min, heap_remove and heap_update all run
+ * in O(log n) time; heap_min is O(1).
+ *
+ * An element's key may change while it is in a heap, as long as
+ * heap_update is called on it afterward.  Elements that compare
+ * equal come out in no particular order, so callers that want a
+ * tie-breaker must build it into the comparison function. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *parent;   /* Parent, or NULL for the root. */
+	struct heap_elem *left;     /* Left child. */
+	struct heap_elem *right;    /* Right child. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (HEAP_ELEM)            \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B.  The least element
+   is at the top of the heap. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Least element, or NULL. */
+	size_t size;                /* Number of elements. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_min (const struct heap *);
+struct heap_elem *heap_pop_min (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
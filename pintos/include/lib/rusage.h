@@ -0,0 +1,25 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Whose usage the getrusage() system call reports. */
+#define RUSAGE_SELF 0           /* The calling process. */
+#define RUSAGE_CHILDREN 1       /* Its children that have been waited
+                                   for, and their children in turn. */
+
+/* Resource usage reported by the getrusage() system call.  Times
+   are in timer ticks. */
+struct rusage {
+	uint64_t user_ticks;        /* Ticks spent in user mode. */
+	uint64_t sys_ticks;         /* Ticks spent in the kernel. */
+	uint64_t vol_switches;      /* # of times it gave up the CPU. */
+	uint64_t invol_switches;    /* # of times it was preempted. */
+	uint64_t lazy_faults;       /* Faults loading a page the first time. */
+	uint64_t swap_faults;       /* Faults bringing back an evicted page. */
+	uint64_t stack_faults;      /* Faults growing the stack. */
+	uint64_t read_bytes;        /* Bytes read by read(). */
+	uint64_t write_bytes;       /* Bytes written by write(). */
+};
+
+#endif /* lib/rusage.h */
@@ -0,0 +1,29 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Number of run queue length histogram buckets.  Bucket 0 counts
+   ticks with no ready thread, bucket I > 0 ticks with between
+   2^(I-1) and 2^I - 1 ready threads, and the last bucket
+   everything longer. */
+#define SCHEDSTAT_RUNQ_BUCKETS 8
+
+/* Scheduler statistics reported by the schedstat() system call.
+   Times are in TSC cycles. */
+struct sched_stat {
+	/* Calling thread. */
+	uint64_t wakeups;               /* # of times readied after blocking. */
+	uint64_t wakeup_cycles;         /* Total time from readied to running. */
+	uint64_t wakeup_max_cycles;     /* Longest time from readied to running. */
+	uint64_t blocked_cycles;        /* Total time spent blocked. */
+	uint64_t vol_switches;          /* # of times it gave up the CPU. */
+	uint64_t invol_switches;        /* # of times it was preempted. */
+
+	/* Whole system. */
+	uint64_t runq_hist[SCHEDSTAT_RUNQ_BUCKETS]; /* Ticks by run queue length. */
+	uint64_t thread_cache_hits;     /* # of threads created on a reused page. */
+	uint64_t thread_cache_misses;   /* # of threads created on a fresh page. */
+};
+
+#endif /* lib/schedstat.h */
@@ -36,6 +36,18 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Instrumentation. */
+	SYS_SCHEDSTAT,              /* Report scheduler statistics. */
+	SYS_GETRUSAGE,              /* Report resource usage. */
+
+	/* Synchronization. */
+	SYS_FUTEX,                  /* Wait or wake on a user address. */
+
+	/* Threads. */
+	SYS_THREAD_CREATE,          /* Start a thread in this process. */
+	SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+	SYS_THREAD_EXIT,            /* Terminate this thread. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,11 +4,18 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <schedstat.h>
+#include <rusage.h>
+#include <futex.h>
 
 /* Process identifier. */
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
@@ -50,6 +57,18 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Instrumentation. */
+int schedstat (struct sched_stat *);
+int getrusage (int who, struct rusage *);
+
+/* Synchronization. */
+int futex (int *uaddr, int op, int val);
+
+/* Threads. */
+tid_t thread_create (void (*func) (void *aux), void *aux);
+int thread_join (tid_t);
+void thread_exit (int status) NO_RETURN;
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -65,6 +65,16 @@ struct intr_frame {
 
 typedef void intr_handler_func (struct intr_frame *);
 
+/* Deferred halves of external interrupt handlers, in the order
+   they run. */
+enum softirq {
+	SOFTIRQ_TIMER,        /* Timer events and MLFQS recalculation. */
+	SOFTIRQ_DISK,         /* Disk completions. */
+	SOFTIRQ_CNT
+};
+
+typedef void softirq_func (void);
+
 void intr_init (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
@@ -72,7 +82,11 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+void softirq_register (enum softirq, softirq_func *, const char *name);
+void softirq_raise (enum softirq);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
+void intr_print_stats (void);
 
 #endif /* threads/interrupt.h */
@@ -0,0 +1,28 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Stack frame of a thread switched out by switch_threads(): the
+   callee-saved registers, then the address it returns to. */
+struct switch_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);
+	uint64_t pad;               /* Keeps the frame 16-byte sized. */
+};
+
+void switch_threads (uint64_t *save_rsp, uint64_t next_rsp);
+void switch_to_frame (uint64_t *save_rsp, struct intr_frame *next_tf);
+void switch_resume (uint64_t rsp) __attribute__ ((noreturn));
+
+/* First code run by a new thread: calls RBX (R12, R13). */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
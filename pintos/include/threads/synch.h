@@ -1,40 +1,172 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+/* Priority wait queue.  Threads come out highest priority first,
+   and in arrival order among equal priorities.  Each waiting
+   thread is represented by a struct waitq_elem, usually on its
+   own stack, and a thread may wait in more than one queue at a
+   time.  When the priority of a waiting thread changes, e.g. by
+   donation, waitq_rekey() moves it in every queue it is in.
+   Push, pop and re-keying take O(log n) time.  Interrupts must be
+   off while a queue is accessed. */
+struct waitq {
+	struct heap heap;           /* Waiters, highest priority on top. */
+	uint64_t next_seq;          /* Arrival stamp of the next waiter. */
+};
+
+/* An entry in a wait queue. */
+struct waitq_elem {
+	struct heap_elem heap_elem; /* Element of `queue'. */
+	struct thread *thread;      /* Waiting thread; its priority is the key. */
+	uint64_t seq;               /* Arrival stamp. */
+	struct waitq *queue;        /* Queue it is in. */
+	struct list_elem thread_elem; /* Element of thread's `waitq_elems'. */
+};
+
+/* Converts pointer to wait queue element WAITQ_ELEM into a pointer
+   to the structure that WAITQ_ELEM is embedded inside. */
+#define waitq_entry(WAITQ_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (WAITQ_ELEM)             \
+		- offsetof (STRUCT, MEMBER)))
+
+void waitq_init (struct waitq *);
+void waitq_push (struct waitq *, struct waitq_elem *, struct thread *);
+struct waitq_elem *waitq_pop (struct waitq *);
+void waitq_remove (struct waitq_elem *);
+struct waitq_elem *waitq_front (const struct waitq *);
+bool waitq_empty (const struct waitq *);
+void waitq_rekey (struct thread *);
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* Waiting threads. */
+	uint64_t waits;             /* # of sema_down() calls that blocked. */
+	uint64_t wait_cycles;       /* TSC cycles spent blocked in sema_down(). */
 };
 
-bool sem_less_priority(const struct list_elem *, const struct list_elem *, void *);
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
  
+/* Priority donated to the holder of a lock through that lock. */
+struct donation {
+	int priority;               /* Priority of top waiter, or PRI_MIN - 1. */
+	struct heap_elem elem;      /* Element of holder's `held_locks'. */
+};
+
+bool donation_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+int lock_effective_priority (const struct thread *);
+
+/* Number of top waiters kept per lock class. */
+#define LOCK_TOP_WAITERS 4
+
+/* Time one thread spent waiting for locks of a class. */
+struct lock_waiter {
+	char name[16];              /* Thread name, or empty if slot is free. */
+	uint64_t wait_cycles;       /* TSC cycles spent waiting. */
+};
+
+/* Locks initialized by the same lock_init() or spinlock_init()
+   call, e.g. all the locks of one kind of object.  Counts their
+   use when lock profiling is on. */
+struct lock_class {
+	const char *name;           /* Argument of lock_init(). */
+	const char *file;           /* Source file of lock_init() call. */
+	int line;                   /* Line of lock_init() call. */
+	bool registered;            /* In list of all classes? */
+	struct list_elem elem;      /* List element. */
+
+	uint64_t acquisitions;      /* # of times a lock was acquired. */
+	uint64_t contended;         /* # of those that had to wait. */
+	uint64_t wait_cycles;       /* TSC cycles spent waiting. */
+	uint64_t max_wait_cycles;   /* Longest single wait. */
+	uint64_t hold_cycles;       /* TSC cycles locks were held. */
+	uint64_t max_hold_cycles;   /* Longest single hold. */
+	struct lock_waiter top_waiters[LOCK_TOP_WAITERS];
+};
+
 /* Lock. */
 struct lock {
-	struct thread *holder;      /* Thread holding lock (for debugging). */
+	struct thread *holder;      /* Thread holding lock. */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct donation donation;   /* Donation to holder. */
+	struct lock_class *class;   /* Class, for profiling. */
+	uint64_t acquire_tsc;       /* When acquired, if profiling. */
 };
 
-void lock_init (struct lock *);
+/* Initializes LOCK.  Each call site is a lock class of its own,
+   named after the argument. */
+#define lock_init(LOCK)                                         \
+	do {                                                          \
+		static struct lock_class lock_class_ =                      \
+			{ .name = #LOCK, .file = __FILE__, .line = __LINE__ };    \
+		lock_init_class ((LOCK), &lock_class_);                     \
+	} while (0)
+
+/* Collect statistics on lock classes? */
+extern bool lock_profiling;
+
+void lock_init_class (struct lock *, struct lock_class *);
 void lock_acquire (struct lock *);
-void donate_priority (struct thread*, int);
 
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+
+/* Reader-writer lock.  Any number of readers, or a single
+   writer, may hold it at a time.  Writers are preferred: once a
+   writer waits, new readers queue up behind it.  Waiting threads
+   donate their priority to the writer, or to every reader, that
+   they wait for. */
+struct rwlock {
+	struct thread *writer;      /* Thread holding lock for writing. */
+	struct donation write_donation; /* Donation to writer. */
+	struct list readers;        /* Read holds, as struct rwlock_hold. */
+	unsigned reader_cnt;        /* Number of readers. */
+	struct thread *upgrader;    /* Reader waiting in rwlock_upgrade(). */
+	struct waitq readers_q;     /* Waiting readers. */
+	struct waitq writers_q;     /* Waiting writers. */
+};
+
+/* One thread's read hold on a reader-writer lock.  The reader
+   provides it, usually on its own stack, and must keep it alive
+   until it releases the lock. */
+struct rwlock_hold {
+	struct rwlock *lock;        /* Lock held. */
+	struct thread *thread;      /* Reader. */
+	struct donation donation;   /* Donation to reader. */
+	struct list_elem elem;      /* Element of lock's `readers'. */
+	struct waitq_elem waiter;   /* Element of lock's `readers_q'. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *, struct rwlock_hold *);
+bool rwlock_try_acquire_read (struct rwlock *, struct rwlock_hold *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *, struct rwlock_hold *);
+bool rwlock_held_for_read (const struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct waitq waiters;       /* One semaphore per waiting thread. */
+	uint64_t waits;             /* # of cond_wait() calls. */
+	uint64_t wait_cycles;       /* TSC cycles spent waiting for a signal. */
 };
 
 void cond_init (struct condition *);
@@ -42,6 +174,32 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Spinlock.  Busy-waits instead of sleeping, so it may be used
+   where blocking is impossible, such as inside the scheduler.
+   Interrupts must be off while it is held, or an interrupt
+   handler that takes the same lock would spin forever. */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+	struct thread *holder;      /* Thread holding lock (for debugging). */
+	struct lock_class *class;   /* Class, for profiling. */
+	uint64_t acquire_tsc;       /* When acquired, if profiling. */
+};
+
+/* Initializes spinlock LOCK.  Each call site is a lock class of
+   its own, named after the argument, as with lock_init(). */
+#define spinlock_init(LOCK)                                     \
+	do {                                                          \
+		static struct lock_class lock_class_ =                      \
+			{ .name = #LOCK, .file = __FILE__, .line = __LINE__ };    \
+		spinlock_init_class ((LOCK), &lock_class_);                 \
+	} while (0)
+
+void spinlock_init_class (struct spinlock *, struct lock_class *);
+void spinlock_acquire (struct spinlock *);
+bool spinlock_try_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held_by_current_thread (const struct spinlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -4,8 +4,12 @@
 #include "threads/synch.h"
 #include <debug.h>
 #include <list.h>
+#include <heap.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
+#include "devices/timer.h"
+#include <schedstat.h>
+#include <rusage.h>
 
 #ifdef VM
 #include "vm/vm.h"
@@ -91,12 +95,11 @@ typedef int tid_t;
  * the `magic' member of the running thread's `struct thread' is
  * set to THREAD_MAGIC.  Stack overflow will normally change this
  * value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
- * the run queue (thread.c), or it can be an element in a
- * semaphore wait list (synch.c).  It can be used these two ways
- * only because they are mutually exclusive: only a thread in the
- * ready state is on the run queue, whereas only a thread in the
- * blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in the run queue (thread.c).
+ * A blocked thread is instead represented in semaphore and
+ * condition variable wait queues (synch.c) by struct waitq_elems
+ * on its own stack, listed in `waitq_elems' so that they can be
+ * re-sorted when its priority changes. */
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;                          /* Thread identifier. */
@@ -104,18 +107,52 @@ struct thread {
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
 	int64_t local_ticks; 					/* local_ticks */
+	struct timer_event sleep_event;		/* Wakes thread_sleep() at local_ticks */
 	int priority_origin;				/* Given priority. Not donated */
+	int ready_priority;					/* Run queue holding elem while ready */
+	int64_t pass;						/* Stride scheduling virtual time */
+	struct heap_elem stride_elem;		/* Element of stride run queue */
+
+	/* Real-time (EDF) class, see thread_create_rt(). */
+	bool rt;                            /* Real-time thread? */
+	int64_t rt_period;                  /* Ticks between releases. */
+	int64_t rt_budget;                  /* Ticks it may run per period. */
+	int64_t rt_rel_deadline;            /* Deadline, relative to release. */
+	int64_t rt_deadline;                /* Absolute deadline of current job. */
+	int64_t rt_remaining;               /* Budget left in this period. */
+	bool rt_throttled;                  /* Out of budget until next release? */
+	bool rt_waiting;                    /* In thread_wait_next_period()? */
+	bool rt_job_done;                   /* Finished this period's job? */
+	struct heap_elem rt_elem;           /* Element of EDF run queue. */
+	struct timer_event rt_release;      /* Fires at the start of each period. */
 	struct lock* pressing_lock;			/* Lock on thread */
+	struct rwlock *pressing_rwlock;     /* Reader-writer lock waited for. */
 
-	struct list donated_thread_list;	/* List of donated priority */
-	struct list_elem donated_elem;      /* List element for donated_thread_list*/
+	struct heap held_locks;				/* Donations, highest priority on top */
 
 	int nice;                           /* Nice */
 	int recent_cpu;                     /* Recent_cpu */
-	struct list_elem total_list_elem;   /* to manage total list_elem*/
+	int64_t recent_cpu_epoch;			/* MLFQS epoch recent_cpu is current for */
+	struct list_elem tid_elem;          /* List element of tid hash bucket */
+
+	/* Scheduler statistics, in TSC cycles. */
+	uint64_t block_tsc;                 /* When it last blocked, or 0. */
+	uint64_t ready_tsc;                 /* When it was readied after blocking, or 0. */
+	uint64_t wakeups;                   /* # of times readied after blocking. */
+	uint64_t wakeup_cycles;             /* Total time from readied to running. */
+	uint64_t wakeup_max_cycles;         /* Longest time from readied to running. */
+	uint64_t blocked_cycles;            /* Total time spent blocked. */
+	uint64_t vol_switches;              /* # of times it gave up the CPU. */
+	uint64_t invol_switches;            /* # of times it was preempted. */
+	bool preempted;                     /* Yielding on the scheduler's behalf? */
+
+	/* Resource usage.  Switches are counted above, not in `ru'. */
+	struct rusage ru;                   /* Its own usage. */
+	struct rusage children_ru;          /* Usage of children waited for. */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
+	struct list waitq_elems;            /* Entries of the wait queues it is in. */
 
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
@@ -138,6 +175,19 @@ struct thread {
 
 	bool is_process_msg;				/* true: msg, false: no msg */
 
+	/* Threads of a multithreaded process, see process_thread_create().
+	   The process's address space and open files live in its first
+	   thread, the leader; the other threads reach them through
+	   `leader', which points to the thread itself otherwise.  What
+	   only concerns the process as a whole is kept in `process',
+	   which is null for a kernel thread. */
+	struct thread *leader;              /* First thread of its process. */
+	struct process *process;            /* Its process, or null. */
+	struct list_elem thread_elem;       /* Element of process's `threads'. */
+	int stack_slot;                     /* Its thread stack, or -1. */
+	bool joined;                        /* Claimed by thread_join()? */
+	bool thread_exited;                 /* Ended by thread_exit()? */
+
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
@@ -149,6 +199,7 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
+	uint64_t switch_rsp;                /* Saved by switch_threads(), or 0. */
 	struct intr_frame tf;               /* Information for switching */
 	unsigned magic;                     /* Detects stack overflow. */
 };
@@ -158,24 +209,44 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use stride (proportional-share) scheduler.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
+/* If true (default), switch between threads by saving only the
+   callee-saved registers, see threads/switch.S.  If false, save a
+   whole intr_frame and switch through iretq, as Pintos originally
+   did.  Kept for comparison by tests/threads/switch-pingpong. */
+extern bool thread_fast_switch;
+
 bool less_ticks(const struct list_elem *,const struct list_elem *,void * );
 bool less_priority(const struct list_elem *,const struct list_elem *,void * );
-bool less_donated_priority(const struct list_elem *,const struct list_elem *,void * );
 
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
 void thread_print_stats (void);
+void thread_get_sched_stat (struct sched_stat *);
+void thread_get_rusage (struct thread *, int who, struct rusage *);
+void thread_reap_rusage (struct thread *child);
+#ifdef USERPROG
+void thread_merge_rusage (void);
+#endif
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
+tid_t thread_create_rt (const char *name, int64_t period, int64_t budget,
+		int64_t deadline, thread_func *, void *);
+void thread_wait_next_period (void);
+
 void thread_block (void);
 void thread_unblock (struct thread *);
 
 void dis_intr_treason (struct thread *);
 void thread_treason (struct thread *);
+void thread_requeue (struct thread *);
 
 struct thread *thread_current (void);
 
@@ -186,7 +257,9 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
-void thread_wakeup(int64_t);
+void thread_yield_preempted (void);
+void thread_preempt (void);
+void thread_wakeup(void *);
 void thread_sleep(int64_t);
 
 int thread_get_priority (void);
@@ -227,7 +300,6 @@ void mlfqs_update_recent_cpu (struct thread *);
 void mlfqs_update_priority (struct thread *);
 // void mlfqs_increse_recent_cpu_running (void);
 void mlfqs_update_all_thread (void);
-void mlfqs_update_all_threads_on_list (struct list*);
 bool is_idle(void);
 
 
@@ -0,0 +1,39 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel tracepoints.  Each names an event and says what its two
+   arguments mean.  "Cycles" is the time the event took, in TSC
+   cycles, for events that are recorded when they finish. */
+enum trace_event {
+	TRACE_THREAD_NAME,          /* Two records: tid, 8 bytes of name. */
+	TRACE_SCHEDULE,             /* Switch: next tid, old status. */
+	TRACE_BLOCK,                /* Running thread blocked. */
+	TRACE_UNBLOCK,              /* Thread readied: tid. */
+	TRACE_PAGE_FAULT,           /* Fault handled: address, cycles. */
+	TRACE_DISK_READ,            /* Sector read: sector, cycles. */
+	TRACE_DISK_WRITE,           /* Sector written: sector, cycles. */
+	TRACE_SYSCALL_ENTER,        /* System call: number. */
+	TRACE_SYSCALL_EXIT,         /* System call: number, result. */
+	TRACE_EVENT_CNT
+};
+
+/* True while tracing.  Tested by TRACE before it does anything
+   else, so tracepoints are cheap when tracing is off. */
+extern bool trace_enabled;
+
+/* Records EVENT with arguments A0 and A1 in the trace buffer. */
+#define TRACE(EVENT, A0, A1)                                    \
+	do {                                                          \
+		if (trace_enabled)                                          \
+			trace_record (EVENT, (uint64_t) (A0), (uint64_t) (A1));   \
+	} while (0)
+
+void trace_init (void);
+void trace_record (enum trace_event, uint64_t a0, uint64_t a1);
+void trace_name (int tid, const char *name);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,56 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+/* Function run by a worker thread for a work item. */
+typedef void work_func (void *aux);
+
+/* A piece of deferred work.  The caller owns the memory and must
+   keep it valid until the work has run or been canceled.  A work
+   item may be queued again once it has started running, even from
+   its own function. */
+struct work {
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Argument to FUNC. */
+	struct workqueue *wq;       /* Queue it was last queued on. */
+	bool pending;               /* Queued and not yet started? */
+	struct list_elem elem;      /* Element of `wq->works'. */
+	struct timer_event timer;   /* Queues it after a delay. */
+};
+
+/* A queue of deferred work.  Work items are run in FIFO order
+   by a pool of kernel worker threads shared by all queues.  A
+   worker always takes work from the highest-priority nonempty
+   queue and runs it at that queue's priority. */
+struct workqueue {
+	const char *name;           /* Name (for debugging purposes). */
+	int priority;               /* Priority work is run at. */
+	struct list works;          /* Pending work items. */
+	int running;                /* # of its items being run. */
+	struct waitq flushers;      /* Threads in flush_workqueue(). */
+	struct list_elem elem;      /* Element of list of all queues. */
+};
+
+/* Queue for general-purpose deferred work, at PRI_DEFAULT. */
+extern struct workqueue *system_wq;
+
+/* Queue for deferred work that is still latency-sensitive, at
+   PRI_MAX. */
+extern struct workqueue *system_highpri_wq;
+
+void workqueue_start (void);
+
+void workqueue_init (struct workqueue *, const char *name, int priority);
+void work_init (struct work *, work_func *, void *aux);
+
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct work *, int64_t ticks);
+bool cancel_work (struct work *);
+void flush_workqueue (struct workqueue *);
+
+#endif /* threads/workqueue.h */
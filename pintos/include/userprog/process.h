@@ -4,6 +4,30 @@
 #include "threads/thread.h"
 
 
+/* State shared by the threads of a user process.  Allocated by
+   the process's first thread, its leader, and freed when the
+   leader exits after the others. */
+struct process {
+	struct list threads;                /* Threads other than the leader. */
+	int live_threads;                   /* # of threads not exited. */
+	struct semaphore threads_sema;      /* Upped as threads exit. */
+	bool exiting;                       /* Process is exiting? */
+	unsigned stack_slots;               /* Thread stacks in use. */
+	struct rusage threads_ru;           /* Usage of exited threads. */
+	struct lock fd_lock;                /* Guards the leader's fd_table
+	                                       and the files in it. */
+	struct list futex_waiters;          /* Threads in futex_wait(). */
+#ifdef VM
+	struct lock fault_lock;             /* Serializes page faults. */
+#endif
+};
+
+/* Serializes the file system.  Lock order is a process's fd_lock,
+   then its fault_lock (see struct process), then open_lock.  A
+   file is read or written with fd_lock held, its buffer faulting
+   in under fault_lock, and munmap writes mapped pages back with
+   open_lock taken under fault_lock, so user memory that may fault
+   must not be touched while open_lock is held. */
 struct lock open_lock;
 
 tid_t process_create_initd (const char *file_name);
@@ -12,6 +36,12 @@ int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (struct thread *next);
+
+tid_t process_thread_create (void *entry, uint64_t arg0, uint64_t arg1,
+		struct intr_frame *if_);
+int process_thread_join (tid_t);
+void process_thread_exit (int status) NO_RETURN;
+void process_check_exit (void);
 int get_rank(const char *file_name);
 
 #endif /* userprog/process.h */
@@ -71,6 +71,7 @@ struct frame {
 	void *kva;
 	struct page *page;
 	struct list_elem elem;
+	int pin_cnt;           /* Not evicted while positive. */
 };
 
 /* The function table for page operations.
@@ -125,6 +126,8 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+void *vm_pin_page (void *uaddr);
+void vm_unpin_page (void *uaddr);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
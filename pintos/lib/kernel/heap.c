@@ -0,0 +1,208 @@
+/* Binary min-heap.  See heap.h for basic information.
+
+   Node number I (counting from 1 at the root, in level order)
+   has children 2I and 2I+1, exactly as in an array heap.  The
+   binary digits of I after the leading 1 spell the path from the
+   root down to node I, 0 meaning left and 1 meaning right, which
+   is how the last node and the next free slot are found. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *find_node (const struct heap *, size_t n);
+static void swap_with_parent (struct heap *, struct heap_elem *);
+static void sift_up (struct heap *, struct heap_elem *);
+static void sift_down (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap ordered by LESS, given auxiliary
+   data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->size = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->left = e->right = NULL;
+	h->size++;
+	if (h->size == 1) {
+		e->parent = NULL;
+		h->root = e;
+		return;
+	}
+
+	e->parent = find_node (h, h->size / 2);
+	if (h->size % 2 == 0)
+		e->parent->left = e;
+	else
+		e->parent->right = e;
+	sift_up (h, e);
+}
+
+/* Returns the least element in H, or a null pointer if H is
+   empty. */
+struct heap_elem *
+heap_min (const struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->root;
+}
+
+/* Removes and returns the least element in H, or returns a null
+   pointer if H is empty. */
+struct heap_elem *
+heap_pop_min (struct heap *h) {
+	struct heap_elem *e = heap_min (h);
+
+	if (e != NULL)
+		heap_remove (h, e);
+	return e;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *last;
+
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+	ASSERT (h->size > 0);
+
+	/* Detach the last node. */
+	last = find_node (h, h->size);
+	if (last->parent == NULL)
+		h->root = NULL;
+	else if (last->parent->left == last)
+		last->parent->left = NULL;
+	else
+		last->parent->right = NULL;
+	h->size--;
+	if (last == e)
+		return;
+
+	/* Put it in E's place and restore the heap order. */
+	last->parent = e->parent;
+	last->left = e->left;
+	last->right = e->right;
+	if (last->parent == NULL)
+		h->root = last;
+	else if (last->parent->left == e)
+		last->parent->left = last;
+	else
+		last->parent->right = last;
+	if (last->left != NULL)
+		last->left->parent = last;
+	if (last->right != NULL)
+		last->right->parent = last;
+	heap_update (h, last);
+}
+
+/* Restores the heap order after the key of E, which must be in
+   H, has changed. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	sift_up (h, e);
+	sift_down (h, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	return heap_size (h) == 0;
+}
+
+/* Returns node number N of H, which must exist. */
+static struct heap_elem *
+find_node (const struct heap *h, size_t n) {
+	struct heap_elem *e = h->root;
+	int bit;
+
+	ASSERT (n >= 1 && n <= h->size);
+	for (bit = 62 - __builtin_clzll (n); bit >= 0; bit--)
+		e = (n >> bit) & 1 ? e->right : e->left;
+	return e;
+}
+
+/* Exchanges E with its parent in the tree structure of H. */
+static void
+swap_with_parent (struct heap *h, struct heap_elem *e) {
+	struct heap_elem *p = e->parent;
+	struct heap_elem *g = p->parent;
+	struct heap_elem *e_left = e->left;
+	struct heap_elem *e_right = e->right;
+
+	/* E takes P's place under G. */
+	e->parent = g;
+	if (g == NULL)
+		h->root = e;
+	else if (g->left == p)
+		g->left = e;
+	else
+		g->right = e;
+
+	/* P becomes E's child; E's sibling stays where it is. */
+	if (p->left == e) {
+		e->left = p;
+		e->right = p->right;
+		if (e->right != NULL)
+			e->right->parent = e;
+	} else {
+		e->right = p;
+		e->left = p->left;
+		if (e->left != NULL)
+			e->left->parent = e;
+	}
+	p->parent = e;
+
+	/* P adopts E's former children. */
+	p->left = e_left;
+	p->right = e_right;
+	if (e_left != NULL)
+		e_left->parent = p;
+	if (e_right != NULL)
+		e_right->parent = p;
+}
+
+/* Moves E up while it is less than its parent. */
+static void
+sift_up (struct heap *h, struct heap_elem *e) {
+	while (e->parent != NULL && h->less (e, e->parent, h->aux))
+		swap_with_parent (h, e);
+}
+
+/* Moves E down while one of its children is less than it. */
+static void
+sift_down (struct heap *h, struct heap_elem *e) {
+	for (;;) {
+		struct heap_elem *c = e->left;
+
+		if (c == NULL)
+			break;
+		if (e->right != NULL && h->less (e->right, c, h->aux))
+			c = e->right;
+		if (!h->less (c, e, h->aux))
+			break;
+		swap_with_parent (h, c);
+	}
+}
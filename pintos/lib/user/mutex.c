@@ -0,0 +1,47 @@
+#include <mutex.h>
+#include <stdbool.h>
+#include <syscall.h>
+
+/* The mutex word is 0 when free, 1 when held, and 2 when held and
+   other threads may be sleeping on it.  Only the transitions that
+   involve sleepers enter the kernel.  See Ulrich Drepper,
+   "Futexes Are Tricky". */
+
+/* Initializes M as free. */
+void
+mutex_init (struct mutex *m) {
+	m->state = 0;
+}
+
+/* Acquires M, sleeping until it is free if necessary. */
+void
+mutex_lock (struct mutex *m) {
+	int c = __sync_val_compare_and_swap (&m->state, 0, 1);
+
+	if (c == 0)
+		return;
+	/* Announce a sleeper, then sleep until we are the one who
+	   finds the mutex free. */
+	if (c != 2)
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	while (c != 0) {
+		futex (&m->state, FUTEX_WAIT, 2);
+		c = __atomic_exchange_n (&m->state, 2, __ATOMIC_ACQUIRE);
+	}
+}
+
+/* Acquires M if it is free, without sleeping.  Returns true if
+   successful. */
+bool
+mutex_trylock (struct mutex *m) {
+	return __sync_bool_compare_and_swap (&m->state, 0, 1);
+}
+
+/* Releases M, waking up a sleeper if there may be one. */
+void
+mutex_unlock (struct mutex *m) {
+	if (__atomic_fetch_sub (&m->state, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n (&m->state, 0, __ATOMIC_RELEASE);
+		futex (&m->state, FUTEX_WAKE, 1);
+	}
+}
@@ -194,3 +194,42 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+int
+schedstat (struct sched_stat *stat) {
+	return syscall1 (SYS_SCHEDSTAT, stat);
+}
+
+int
+getrusage (int who, struct rusage *usage) {
+	return syscall2 (SYS_GETRUSAGE, who, usage);
+}
+
+int
+futex (int *uaddr, int op, int val) {
+	return syscall3 (SYS_FUTEX, uaddr, op, val);
+}
+
+/* Where a thread started by thread_create() begins: calls FUNC
+   with AUX and ends the thread with status 0 if it returns. */
+static void
+thread_start (void (*func) (void *aux), void *aux) {
+	func (aux);
+	thread_exit (0);
+}
+
+tid_t
+thread_create (void (*func) (void *aux), void *aux) {
+	return syscall3 (SYS_THREAD_CREATE, thread_start, func, aux);
+}
+
+int
+thread_join (tid_t tid) {
+	return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+thread_exit (int status) {
+	syscall1 (SYS_THREAD_EXIT, status);
+	NOT_REACHED ();
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/* Checks admission control of real-time threads: parameters that
+   make no sense are refused, and so is any thread that would push
+   the combined utilization of real-time threads above 100%.
+
+   Each admitted thread outranks the main thread, so it runs as
+   soon as it is created.  It then waits for its next release
+   until told to quit, keeping its share reserved meanwhile. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func rt_thread;
+static struct semaphore done;
+static volatile bool quit;
+
+static void create (const char *name, int64_t period, int64_t budget,
+                    int64_t deadline);
+
+void
+test_edf_admit (void) 
+{
+  int i;
+
+  sema_init (&done, 0);
+  quit = false;
+
+  if (thread_create_rt ("bad", 8, 0, 8, rt_thread, NULL) == TID_ERROR
+      && thread_create_rt ("bad", 8, 6, 4, rt_thread, NULL) == TID_ERROR
+      && thread_create_rt ("bad", 8, 4, 16, rt_thread, NULL) == TID_ERROR)
+    msg ("Inconsistent parameters rejected.");
+
+  create ("rt 25%", 8, 2, 4);
+  create ("rt 50%", 16, 8, 16);
+  create ("rt 50%", 8, 4, 8);
+  create ("rt 25%", 4, 1, 4);
+  create ("rt 1/64", 64, 1, 64);
+
+  quit = true;
+  for (i = 0; i < 3; i++)
+    sema_down (&done);
+  msg ("Real-time threads done.");
+}
+
+static void
+create (const char *name, int64_t period, int64_t budget, int64_t deadline) 
+{
+  if (thread_create_rt (name, period, budget, deadline, rt_thread, NULL)
+      == TID_ERROR)
+    msg ("Thread %s rejected.", name);
+}
+
+static void
+rt_thread (void *aux UNUSED) 
+{
+  msg ("Thread %s running.", thread_name ());
+  while (!quit)
+    thread_wait_next_period ();
+  sema_up (&done);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) Inconsistent parameters rejected.
+(edf-admit) Thread rt 25% running.
+(edf-admit) Thread rt 50% running.
+(edf-admit) Thread rt 50% rejected.
+(edf-admit) Thread rt 25% running.
+(edf-admit) Thread rt 1/64 rejected.
+(edf-admit) Real-time threads done.
+(edf-admit) end
+EOF
+pass;
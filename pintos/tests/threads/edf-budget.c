@@ -0,0 +1,63 @@
+/* Checks that a real-time thread that overruns its budget is
+   parked until its next release, and that ordinary threads run
+   in the meantime.
+
+   The real-time thread may run BUDGET ticks in each PERIOD but
+   tries to spin for SPIN ticks.  It must be taken off the CPU
+   once its budget is spent and resume only when the next period
+   starts, while the main thread, an ordinary thread busy-waiting
+   for it, makes progress. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define PERIOD 10
+#define BUDGET 2
+#define SPIN 5
+
+static thread_func rt_thread;
+static volatile bool done;
+static volatile int64_t main_spins;
+
+void
+test_edf_budget (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  done = false;
+  main_spins = 0;
+
+  /* Start at the beginning of a tick, so that the real-time
+     thread has its whole first period. */
+  timer_sleep (1);
+  thread_create_rt ("overrun", PERIOD, BUDGET, PERIOD, rt_thread, NULL);
+  while (!done)
+    main_spins++;
+  msg ("Main thread done.");
+}
+
+static void
+rt_thread (void *aux UNUSED) 
+{
+  int64_t start, end, spins;
+
+  msg ("Spinning for %d ticks on a budget of %d.", SPIN, BUDGET);
+  start = timer_ticks ();
+  spins = main_spins;
+  while (timer_ticks () < start + SPIN)
+    continue;
+  end = timer_ticks ();
+
+  if (end - start >= PERIOD - BUDGET)
+    msg ("Parked until the next period.");
+  else
+    msg ("Ran %"PRId64" ticks without a break.", end - start);
+  if (main_spins != spins)
+    msg ("Main thread ran meanwhile.");
+  done = true;
+}
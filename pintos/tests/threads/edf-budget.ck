@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-budget) begin
+(edf-budget) Spinning for 5 ticks on a budget of 2.
+(edf-budget) Parked until the next period.
+(edf-budget) Main thread ran meanwhile.
+(edf-budget) Main thread done.
+(edf-budget) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Checks that ready real-time threads are dispatched earliest
+   deadline first, ahead of even the highest priority ordinary
+   thread.
+
+   Two threads with the same period are created in the same tick,
+   so their releases coincide.  The one created second has the
+   shorter relative deadline, so its job must run first in every
+   period.  Meanwhile the main thread, at PRI_MAX, busy-waits
+   across all the releases, and each job must preempt it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define PERIOD 20
+#define ROUNDS 3
+
+static thread_func rt_thread;
+
+void
+test_edf_order (void) 
+{
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_set_priority (PRI_MAX);
+
+  /* Start at the beginning of a tick, so that both threads are
+     created within it. */
+  timer_sleep (1);
+  start = timer_ticks ();
+  thread_create_rt ("late", PERIOD, 2, PERIOD, rt_thread, NULL);
+  thread_create_rt ("early", PERIOD, 2, PERIOD / 4, rt_thread, NULL);
+  if (timer_ticks () != start)
+    msg ("Creating the threads took more than a tick.");
+
+  while (timer_ticks () < start + PERIOD * ROUNDS + 1)
+    continue;
+  msg ("Main thread done spinning.");
+}
+
+static void
+rt_thread (void *aux UNUSED) 
+{
+  int i;
+
+  /* Nothing to do in the first period. */
+  thread_wait_next_period ();
+  for (i = 1; i <= ROUNDS; i++) 
+    {
+      msg ("Thread %s, job %d.", thread_name (), i);
+      thread_wait_next_period ();
+    }
+}
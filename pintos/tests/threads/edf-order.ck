@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-order) begin
+(edf-order) Thread early, job 1.
+(edf-order) Thread late, job 1.
+(edf-order) Thread early, job 2.
+(edf-order) Thread late, job 2.
+(edf-order) Thread early, job 3.
+(edf-order) Thread late, job 3.
+(edf-order) Main thread done spinning.
+(edf-order) end
+EOF
+pass;
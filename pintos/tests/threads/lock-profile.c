@@ -0,0 +1,47 @@
+/* Checks the lock profiler.  The main thread holds a lock while a
+   higher-priority thread tries to acquire it, which must count as
+   one contended acquisition charged to that thread. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func contender_func;
+
+void
+test_lock_profile (void) 
+{
+  struct lock lock;
+  struct lock_class *class;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_profiling = true;
+  lock_init (&lock);
+  class = lock.class;
+
+  lock_acquire (&lock);
+  thread_create ("contender", PRI_DEFAULT + 1, contender_func, &lock);
+  lock_release (&lock);
+
+  msg ("%llu acquisitions, %llu contended.",
+       class->acquisitions, class->contended);
+  if (strcmp (class->top_waiters[0].name, "contender"))
+    fail ("top waiter is \"%s\", not \"contender\"",
+          class->top_waiters[0].name);
+  msg ("Top waiter is contender.");
+  if (class->wait_cycles == 0 || class->hold_cycles == 0)
+    fail ("no wait or hold time recorded");
+  msg ("Wait and hold time recorded.");
+}
+
+static void
+contender_func (void *lock) 
+{
+  lock_acquire (lock);
+  lock_release (lock);
+}
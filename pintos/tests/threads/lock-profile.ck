@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-profile) begin
+(lock-profile) 2 acquisitions, 1 contended.
+(lock-profile) Top waiter is contender.
+(lock-profile) Wait and hold time recorded.
+(lock-profile) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Tests that cond_signal() wakes up the highest-priority waiter
+   even if a waiter's priority drops after it started waiting.
+
+   A thread holding the monitor lock with a priority donated
+   through that lock calls cond_wait().  It is queued at the
+   donated priority, then loses the donation when cond_wait()
+   releases the lock, so it must move behind a waiter whose
+   priority it no longer beats. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func waiter_thread;
+static thread_func donor_thread;
+static struct lock lock;
+static struct condition condition;
+static struct semaphore go;
+
+void
+test_priority_condvar_donate (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  cond_init (&condition);
+  sema_init (&go, 0);
+
+  thread_create ("high waiter", PRI_DEFAULT + 7, waiter_thread, NULL);
+  thread_create ("low waiter", PRI_DEFAULT + 1, waiter_thread, &go);
+  thread_create ("donor", PRI_DEFAULT + 9, donor_thread, NULL);
+  sema_up (&go);
+
+  for (i = 0; i < 2; i++) 
+    {
+      lock_acquire (&lock);
+      msg ("Signaling...");
+      cond_signal (&condition, &lock);
+      lock_release (&lock);
+    }
+}
+
+/* Waits on CONDITION.  If GO_ is non-null, first waits for it
+   while holding the lock, so that the donor can donate. */
+static void
+waiter_thread (void *go_) 
+{
+  struct semaphore *go = go_;
+
+  lock_acquire (&lock);
+  if (go != NULL)
+    sema_down (go);
+  msg ("Thread %s waiting with priority %d.",
+       thread_name (), thread_get_priority ());
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+donor_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("Donor got the lock.");
+  lock_release (&lock);
+}
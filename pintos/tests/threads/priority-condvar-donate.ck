@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-donate) begin
+(priority-condvar-donate) Thread high waiter waiting with priority 38.
+(priority-condvar-donate) Thread low waiter waiting with priority 40.
+(priority-condvar-donate) Donor got the lock.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread high waiter woke up.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread low waiter woke up.
+(priority-condvar-donate) end
+EOF
+pass;
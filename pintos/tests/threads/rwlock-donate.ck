@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) This thread should have priority 32.  Actual priority: 32.
+(rwlock-donate) This thread should have priority 33.  Actual priority: 33.
+(rwlock-donate) writer: got the lock for writing
+(rwlock-donate) reader: got the lock for reading
+(rwlock-donate) reader: done
+(rwlock-donate) writer: done
+(rwlock-donate) writer and reader must already have finished.
+(rwlock-donate) This thread should have priority 31.  Actual priority: 31.
+(rwlock-donate) end
+EOF
+pass;
@@ -0,0 +1,81 @@
+/* Checks rwlock_try_acquire_read() and rwlock_try_acquire_write()
+   against a free lock, a lock held for writing, a lock held for
+   reading, and a lock held for reading that a writer waits for,
+   which must turn new readers away.
+
+   Each attempt is made by a new thread of higher priority, which
+   runs to completion as soon as it is created. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func try_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_try (void) 
+{
+  struct rwlock rw;
+  struct rwlock_hold hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  msg ("Lock is free.");
+  thread_create ("try", PRI_DEFAULT + 2, try_thread_func, &rw);
+
+  if (rwlock_try_acquire_write (&rw))
+    msg ("Lock is held for writing.");
+  thread_create ("try", PRI_DEFAULT + 2, try_thread_func, &rw);
+  rwlock_release_write (&rw);
+
+  if (rwlock_try_acquire_read (&rw, &hold))
+    msg ("Lock is held for reading.");
+  thread_create ("try", PRI_DEFAULT + 2, try_thread_func, &rw);
+
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  msg ("A writer is waiting.");
+  thread_create ("try", PRI_DEFAULT + 2, try_thread_func, &rw);
+  rwlock_release_read (&rw);
+  msg ("writer must already have finished.");
+}
+
+static void
+try_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+  struct rwlock_hold hold;
+
+  if (rwlock_try_acquire_read (rw, &hold)) 
+    {
+      msg ("try: got the lock for reading");
+      rwlock_release_read (rw);
+    }
+  else
+    msg ("try: could not get the lock for reading");
+
+  if (rwlock_try_acquire_write (rw)) 
+    {
+      msg ("try: got the lock for writing");
+      rwlock_release_write (rw);
+    }
+  else
+    msg ("try: could not get the lock for writing");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("writer: got the lock for writing");
+  rwlock_release_write (rw);
+}
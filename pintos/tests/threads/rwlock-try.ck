@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-try) begin
+(rwlock-try) Lock is free.
+(rwlock-try) try: got the lock for reading
+(rwlock-try) try: got the lock for writing
+(rwlock-try) Lock is held for writing.
+(rwlock-try) try: could not get the lock for reading
+(rwlock-try) try: could not get the lock for writing
+(rwlock-try) Lock is held for reading.
+(rwlock-try) try: got the lock for reading
+(rwlock-try) try: could not get the lock for writing
+(rwlock-try) A writer is waiting.
+(rwlock-try) try: could not get the lock for reading
+(rwlock-try) try: could not get the lock for writing
+(rwlock-try) writer: got the lock for writing
+(rwlock-try) writer must already have finished.
+(rwlock-try) end
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Checks rwlock_upgrade() and rwlock_downgrade().
+
+   The sole reader of a lock upgrades at once.  Next the main
+   thread upgrades while another reader, "holder", still holds
+   the lock, so it must wait; holder's own attempt to upgrade in
+   the meantime must fail instead of deadlocking, and once holder
+   lets go the main thread becomes the writer.  Finally the main
+   thread downgrades, which lets in a reader that was waiting for
+   it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func holder_thread_func;
+static thread_func waker_thread_func;
+static thread_func reader_thread_func;
+static struct semaphore go;
+
+void
+test_rwlock_upgrade (void) 
+{
+  struct rwlock rw;
+  struct rwlock_hold hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  sema_init (&go, 0);
+
+  rwlock_acquire_read (&rw, &hold);
+  if (rwlock_upgrade (&rw) && rwlock_held_for_write (&rw))
+    msg ("Sole reader upgraded at once.");
+  rwlock_downgrade (&rw, &hold);
+  if (rwlock_held_for_read (&rw) && !rwlock_held_for_write (&rw))
+    msg ("Downgraded to a reader.");
+
+  /* holder reads, then waits for waker, which only runs once
+     this thread blocks in rwlock_upgrade(). */
+  thread_create ("holder", PRI_DEFAULT + 1, holder_thread_func, &rw);
+  thread_create ("waker", PRI_DEFAULT - 1, waker_thread_func, NULL);
+  msg ("Upgrading while holder reads.");
+  if (rwlock_upgrade (&rw) && rwlock_held_for_write (&rw))
+    msg ("Upgraded after holder let go.");
+
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  msg ("Downgrading with reader waiting.");
+  rwlock_downgrade (&rw, &hold);
+  if (rwlock_held_for_read (&rw))
+    msg ("Main thread still holds the lock for reading.");
+  rwlock_release_read (&rw);
+}
+
+static void
+holder_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+  struct rwlock_hold hold;
+
+  rwlock_acquire_read (rw, &hold);
+  msg ("holder: got the lock for reading");
+  sema_down (&go);
+  if (!rwlock_upgrade (rw))
+    msg ("holder: upgrade refused, main is upgrading");
+  rwlock_release_read (rw);
+  msg ("holder: done");
+}
+
+static void
+waker_thread_func (void *aux UNUSED) 
+{
+  sema_up (&go);
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+  struct rwlock_hold hold;
+
+  rwlock_acquire_read (rw, &hold);
+  msg ("reader: got the lock for reading");
+  rwlock_release_read (rw);
+  msg ("reader: done");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-upgrade) begin
+(rwlock-upgrade) Sole reader upgraded at once.
+(rwlock-upgrade) Downgraded to a reader.
+(rwlock-upgrade) holder: got the lock for reading
+(rwlock-upgrade) Upgrading while holder reads.
+(rwlock-upgrade) holder: upgrade refused, main is upgrading
+(rwlock-upgrade) holder: done
+(rwlock-upgrade) Upgraded after holder let go.
+(rwlock-upgrade) Downgrading with reader waiting.
+(rwlock-upgrade) reader: got the lock for reading
+(rwlock-upgrade) reader: done
+(rwlock-upgrade) Main thread still holds the lock for reading.
+(rwlock-upgrade) end
+EOF
+pass;
@@ -0,0 +1,63 @@
+/* Checks that an external interrupt may be taken while softirqs
+   run.  A timer event busy-waits for a tick and a half with
+   interrupts off, so the next timer interrupt is pending when it
+   returns and is taken inside the timer softirq, between events.
+   That interrupt raises the softirq again, and an event due at
+   the tick it counts must then fire as usual. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+static timer_event_func spin_event;
+static timer_event_func next_event;
+static struct semaphore done;
+static volatile bool spin_in_context;
+static volatile int64_t next_fired;
+
+void
+test_softirq_nest (void) 
+{
+  struct timer_event spin, next;
+  int64_t start;
+
+  sema_init (&done, 0);
+  timer_event_init (&spin, spin_event, NULL);
+  timer_event_init (&next, next_event, NULL);
+
+  timer_sleep (1);
+  start = timer_ticks ();
+  timer_event_add (&spin, start + 2);
+  timer_event_add (&next, start + 3);
+  sema_down (&done);
+
+  if (spin_in_context)
+    msg ("Spinning event ran in interrupt context.");
+  if (next_fired == start + 3)
+    msg ("Next event fired on time.");
+  else
+    msg ("Next event fired %lld ticks after the start, not 3.",
+         next_fired - start);
+}
+
+static void
+spin_event (void *aux UNUSED) 
+{
+  int64_t start = timer_ns ();
+
+  spin_in_context = intr_context ();
+  while (timer_ns () - start < NS_PER_TICK * 3 / 2)
+    continue;
+}
+
+static void
+next_event (void *aux UNUSED) 
+{
+  next_fired = timer_ticks ();
+  sema_up (&done);
+}
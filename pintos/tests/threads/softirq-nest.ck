@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(softirq-nest) begin
+(softirq-nest) Spinning event ran in interrupt context.
+(softirq-nest) Next event fired on time.
+(softirq-nest) end
+EOF
+pass;
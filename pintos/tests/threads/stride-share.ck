@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::mlfqs;
+our ($test);
+
+my (@tickets) = (10, 20, 30);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@actual);
+local ($_);
+foreach (@output) {
+    my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+    $actual[$id] = $count;
+}
+
+# Each thread should get its share of the ticks actually handed
+# out, within 5% of the total.
+my ($total) = 0;
+$total += $_ foreach grep (defined, @actual);
+my ($sum) = 0;
+$sum += $_ foreach @tickets;
+my (@expected) = map ($total * $_ / $sum, @tickets);
+my ($maxdiff) = $total * .05;
+
+mlfqs_compare ("thread", "%.0f", \@actual, \@expected, $maxdiff,
+	       [0, $#tickets, 1],
+	       "Some tick counts were missing or differed from the "
+	       . "threads' ticket shares by more than 5%.");
+pass;
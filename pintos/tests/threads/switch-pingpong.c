@@ -0,0 +1,80 @@
+/* Measures the round trip of a semaphore ping-pong between two
+   threads of equal priority, which takes two context switches,
+   first switching through a whole intr_frame and iretq, then
+   through switch_threads().  Reports both in TSC cycles. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define WARMUP 100
+#define ROUNDS 2000
+
+struct pingpong 
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+  };
+
+static thread_func pong_thread_func;
+static uint64_t measure (struct pingpong *);
+
+void
+test_switch_pingpong (void) 
+{
+  static struct pingpong slow, fast;
+  uint64_t slow_cycles, fast_cycles;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_fast_switch = false;
+  slow_cycles = measure (&slow);
+  thread_fast_switch = true;
+  fast_cycles = measure (&fast);
+
+  msg ("iretq switch: %llu cycles per round trip.", slow_cycles);
+  msg ("fast switch: %llu cycles per round trip.", fast_cycles);
+}
+
+/* Returns the average cycles per ping-pong round trip with a new
+   thread, using PP. */
+static uint64_t
+measure (struct pingpong *pp) 
+{
+  uint64_t start;
+  int i;
+
+  sema_init (&pp->ping, 0);
+  sema_init (&pp->pong, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread_func, pp);
+
+  for (i = 0; i < WARMUP; i++) 
+    {
+      sema_up (&pp->ping);
+      sema_down (&pp->pong);
+    }
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      sema_up (&pp->ping);
+      sema_down (&pp->pong);
+    }
+  return (rdtsc () - start) / ROUNDS;
+}
+
+static void
+pong_thread_func (void *pp_) 
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < WARMUP + ROUNDS; i++) 
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($slow, $fast);
+local ($_);
+foreach (@output) {
+    $slow = $1 if /iretq switch: (\d+) cycles per round trip\./;
+    $fast = $1 if /fast switch: (\d+) cycles per round trip\./;
+}
+fail "missing iretq switch timing\n" if !defined $slow;
+fail "missing fast switch timing\n" if !defined $fast;
+pass;
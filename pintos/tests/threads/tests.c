@@ -29,6 +29,20 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-condvar-donate", test_priority_condvar_donate},
+    {"stride-share", test_stride_share},
+    {"edf-admit", test_edf_admit},
+    {"edf-order", test_edf_order},
+    {"edf-budget", test_edf_budget},
+    {"rwlock-donate", test_rwlock_donate},
+    {"rwlock-try", test_rwlock_try},
+    {"rwlock-upgrade", test_rwlock_upgrade},
+    {"workqueue-priority", test_workqueue_priority},
+    {"thread-recycle", test_thread_recycle},
+    {"switch-pingpong", test_switch_pingpong},
+    {"timer-hires", test_timer_hires},
+    {"softirq-nest", test_softirq_nest},
+    {"lock-profile", test_lock_profile},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -23,6 +23,20 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_condvar_donate;
+extern test_func test_stride_share;
+extern test_func test_edf_admit;
+extern test_func test_edf_order;
+extern test_func test_edf_budget;
+extern test_func test_rwlock_donate;
+extern test_func test_rwlock_try;
+extern test_func test_rwlock_upgrade;
+extern test_func test_workqueue_priority;
+extern test_func test_thread_recycle;
+extern test_func test_switch_pingpong;
+extern test_func test_timer_hires;
+extern test_func test_softirq_nest;
+extern test_func test_lock_profile;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,40 @@
+/* Creates a series of higher-priority threads that exit at once.
+   Each one frees its page only when the next thread is scheduled
+   away from, so every thread after the second should be created
+   on the page of a thread that died before it. */
+
+#include <stdio.h>
+#include <schedstat.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 10
+
+static thread_func exit_thread_func;
+
+void
+test_thread_recycle (void) 
+{
+  struct sched_stat before, after;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  thread_get_sched_stat (&before);
+  for (i = 0; i < THREAD_CNT; i++)
+    thread_create ("exiter", PRI_DEFAULT + 1, exit_thread_func, NULL);
+  thread_get_sched_stat (&after);
+
+  msg ("Created %d threads.", THREAD_CNT);
+  if (after.thread_cache_hits - before.thread_cache_hits < THREAD_CNT - 2)
+    fail ("only %llu of %d threads reused a page",
+          after.thread_cache_hits - before.thread_cache_hits, THREAD_CNT);
+  msg ("At least %d of them reused a page.", THREAD_CNT - 2);
+}
+
+static void
+exit_thread_func (void *aux UNUSED) 
+{
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-recycle) begin
+(thread-recycle) Created 10 threads.
+(thread-recycle) At least 8 of them reused a page.
+(thread-recycle) end
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Checks the high-resolution sleeps.  A sleep shorter than a tick
+   must last at least as long as asked; a longer one must also let
+   a lower-priority thread run, showing that it blocked instead of
+   spinning the whole time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func spin_thread_func;
+static volatile bool done;
+static volatile int64_t spins;
+
+void
+test_timer_hires (void) 
+{
+  struct semaphore exited;
+  int64_t start, ns;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  start = timer_ns ();
+  timer_usleep (200);
+  ns = timer_ns () - start;
+  if (ns < 200 * 1000)
+    fail ("timer_usleep(200) returned after %lld ns", ns);
+  msg ("timer_usleep(200) slept at least 200 us.");
+
+  sema_init (&exited, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spin_thread_func, &exited);
+
+  start = timer_ns ();
+  timer_msleep (35);
+  ns = timer_ns () - start;
+  if (ns < 35 * 1000 * 1000)
+    fail ("timer_msleep(35) returned after %lld ns", ns);
+  msg ("timer_msleep(35) slept at least 35 ms.");
+  if (spins == 0)
+    fail ("lower-priority thread never ran during timer_msleep(35)");
+  msg ("Lower-priority thread ran meanwhile.");
+
+  done = true;
+  sema_down (&exited);
+}
+
+static void
+spin_thread_func (void *exited) 
+{
+  while (!done)
+    spins++;
+  sema_up (exited);
+}
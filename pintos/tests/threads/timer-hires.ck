@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-hires) begin
+(timer-hires) timer_usleep(200) slept at least 200 us.
+(timer-hires) timer_msleep(35) slept at least 35 ms.
+(timer-hires) Lower-priority thread ran meanwhile.
+(timer-hires) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Queues work on a low-priority queue, then on the high-priority
+   system queue.  The high-priority work must preempt the main
+   thread as soon as it is queued, while the low-priority work
+   must wait until the main thread flushes its queue.  Then checks
+   that delayed work runs after its delay and that canceled
+   delayed work does not run at all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static work_func record;
+
+void
+test_workqueue_priority (void) 
+{
+  static struct workqueue low_wq;
+  static struct work low, high, delayed, canceled;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  workqueue_init (&low_wq, "low", PRI_DEFAULT - 10);
+  work_init (&low, record, "low");
+  work_init (&high, record, "high");
+  work_init (&delayed, record, "delayed");
+  work_init (&canceled, record, "canceled");
+
+  queue_work (&low_wq, &low);
+  msg ("Queued low-priority work.");
+  queue_work (system_highpri_wq, &high);
+  msg ("Queued high-priority work.");
+  flush_workqueue (&low_wq);
+  msg ("Flushed low-priority queue.");
+
+  queue_delayed_work (system_highpri_wq, &delayed, 5);
+  queue_delayed_work (&low_wq, &canceled, 5);
+  if (!cancel_work (&canceled))
+    fail ("pending delayed work could not be canceled");
+  if (cancel_work (&canceled))
+    fail ("canceled delayed work was canceled again");
+  msg ("Queued delayed work.");
+  timer_sleep (10);
+  msg ("Slept past the delay.");
+}
+
+static void
+record (void *name) 
+{
+  msg ("%s work ran at priority %d.", (const char *) name,
+       thread_get_priority ());
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-priority) begin
+(workqueue-priority) Queued low-priority work.
+(workqueue-priority) high work ran at priority 63.
+(workqueue-priority) Queued high-priority work.
+(workqueue-priority) low work ran at priority 21.
+(workqueue-priority) Flushed low-priority queue.
+(workqueue-priority) Queued delayed work.
+(workqueue-priority) delayed work ran at priority 63.
+(workqueue-priority) Slept past the delay.
+(workqueue-priority) end
+EOF
+pass;
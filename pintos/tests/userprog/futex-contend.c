@@ -0,0 +1,64 @@
+/* Exercises futex() and the user mutexes with threads.  Two
+   threads increment a shared counter under a mutex.  They start
+   while the main thread holds it, so that both sleep in
+   mutex_lock() and are woken through mutex_unlock().  Then a
+   FUTEX_WAIT is woken by a FUTEX_WAKE. */
+
+#include <mutex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ITERS 200
+
+static struct mutex m = MUTEX_INITIALIZER;
+static int counter;
+static int word;
+static int wait_result = -2;
+
+static void
+adder (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERS; i++)
+    {
+      volatile int j;
+      int c;
+
+      mutex_lock (&m);
+      c = counter;
+      for (j = 0; j < 1000; j++)
+        continue;
+      counter = c + 1;
+      mutex_unlock (&m);
+    }
+}
+
+static void
+waiter (void *aux UNUSED)
+{
+  wait_result = futex (&word, FUTEX_WAIT, 0);
+}
+
+void
+test_main (void) 
+{
+  tid_t a, b, w;
+
+  mutex_lock (&m);
+  CHECK ((a = thread_create (adder, NULL)) != TID_ERROR, "create adder 1");
+  CHECK ((b = thread_create (adder, NULL)) != TID_ERROR, "create adder 2");
+  CHECK (m.state == 2, "adders wait for the mutex");
+  mutex_unlock (&m);
+  CHECK (thread_join (a) == 0, "join adder 1");
+  CHECK (thread_join (b) == 0, "join adder 2");
+  CHECK (counter == 2 * ITERS, "counter is %d", 2 * ITERS);
+  CHECK (m.state == 0, "mutex is free");
+
+  CHECK ((w = thread_create (waiter, NULL)) != TID_ERROR, "create waiter");
+  while (futex (&word, FUTEX_WAKE, 1) == 0)
+    continue;
+  CHECK (thread_join (w) == 0, "join waiter");
+  CHECK (wait_result == 0, "wait was woken by wake");
+}
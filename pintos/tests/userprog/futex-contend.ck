@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-contend) begin
+(futex-contend) create adder 1
+(futex-contend) create adder 2
+(futex-contend) adders wait for the mutex
+(futex-contend) join adder 1
+(futex-contend) join adder 2
+(futex-contend) counter is 400
+(futex-contend) mutex is free
+(futex-contend) create waiter
+(futex-contend) join waiter
+(futex-contend) wait was woken by wake
+(futex-contend) end
+futex-contend: exit(0)
+EOF
+pass;
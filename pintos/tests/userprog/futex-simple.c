@@ -0,0 +1,26 @@
+/* Exercises futex() and the user mutexes built on it in a single
+   process: a wait on a stale value returns at once, a wake with
+   no sleepers wakes nobody, and uncontended locking works. */
+
+#include <mutex.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static int word = 5;
+  struct mutex m;
+
+  CHECK (futex (&word, FUTEX_WAIT, 4) == -1, "wait on stale value");
+  CHECK (futex (&word, FUTEX_WAKE, 1) == 0, "wake with no sleepers");
+
+  mutex_init (&m);
+  mutex_lock (&m);
+  CHECK (!mutex_trylock (&m), "trylock held mutex");
+  mutex_unlock (&m);
+  CHECK (mutex_trylock (&m), "trylock free mutex");
+  mutex_unlock (&m);
+  CHECK (m.state == 0, "mutex is free");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-simple) begin
+(futex-simple) wait on stale value
+(futex-simple) wake with no sleepers
+(futex-simple) trylock held mutex
+(futex-simple) trylock free mutex
+(futex-simple) mutex is free
+(futex-simple) end
+futex-simple: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Checks that getrusage() counts console output for the process
+   itself and, once it has been waited for, for its child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct rusage ru;
+  int pid;
+
+  CHECK (getrusage (RUSAGE_SELF, &ru) == 0, "getrusage(RUSAGE_SELF)");
+  CHECK (ru.write_bytes > 0, "own output counted");
+  CHECK (getrusage (2, &ru) == -1, "getrusage(2) fails");
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage(RUSAGE_CHILDREN)");
+  CHECK (ru.write_bytes == 0, "no children yet");
+
+  if ((pid = fork ("child-simple")) == 0)
+    exec ("child-simple");
+  msg ("wait(exec()) = %d", wait (pid));
+
+  CHECK (getrusage (RUSAGE_CHILDREN, &ru) == 0, "getrusage(RUSAGE_CHILDREN)");
+  CHECK (ru.write_bytes > 0, "child's output counted");
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage-simple) begin
+(getrusage-simple) getrusage(RUSAGE_SELF)
+(getrusage-simple) own output counted
+(getrusage-simple) getrusage(2) fails
+(getrusage-simple) getrusage(RUSAGE_CHILDREN)
+(getrusage-simple) no children yet
+(child-simple) run
+child-simple: exit(81)
+(getrusage-simple) wait(exec()) = 81
+(getrusage-simple) getrusage(RUSAGE_CHILDREN)
+(getrusage-simple) child's output counted
+(getrusage-simple) end
+getrusage-simple: exit(0)
+EOF
+pass;
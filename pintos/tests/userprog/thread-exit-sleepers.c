@@ -0,0 +1,33 @@
+/* Exits the process while its other threads sleep, one in
+   futex() on a value nobody changes and one joining that
+   thread.  The exit must wake them both up, or the process
+   would never end. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static int word;
+static tid_t sleeper;
+
+static void
+futex_sleeper (void *aux UNUSED)
+{
+  futex (&word, FUTEX_WAIT, 0);
+  fail ("futex() returned");
+}
+
+static void
+joiner (void *aux UNUSED)
+{
+  thread_join (sleeper);
+  fail ("thread_join() returned");
+}
+
+void
+test_main (void) 
+{
+  CHECK ((sleeper = thread_create (futex_sleeper, NULL)) != TID_ERROR,
+         "create futex sleeper");
+  CHECK (thread_create (joiner, NULL) != TID_ERROR, "create joiner");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit-sleepers) begin
+(thread-exit-sleepers) create futex sleeper
+(thread-exit-sleepers) create joiner
+(thread-exit-sleepers) end
+thread-exit-sleepers: exit(0)
+EOF
+pass;
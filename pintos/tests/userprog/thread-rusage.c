@@ -0,0 +1,38 @@
+/* Checks that getrusage(RUSAGE_SELF) reports the usage of the
+   whole process: a thread sees the main thread's output, and the
+   main thread still sees what a thread read after it exited. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/sample.inc"
+
+static int sample_fd;
+static int worker_read;
+static struct rusage worker_ru;
+
+static void
+worker (void *aux UNUSED)
+{
+  char buf[sizeof sample - 1];
+
+  getrusage (RUSAGE_SELF, &worker_ru);
+  worker_read = read (sample_fd, buf, sizeof buf);
+}
+
+void
+test_main (void) 
+{
+  struct rusage ru;
+  tid_t tid;
+
+  CHECK ((sample_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((tid = thread_create (worker, NULL)) != TID_ERROR, "thread_create");
+  CHECK (thread_join (tid) == 0, "thread_join");
+  CHECK (worker_ru.write_bytes > 0, "thread counts main thread's output");
+  CHECK (worker_read == (int) sizeof sample - 1,
+         "thread read \"sample.txt\"");
+
+  CHECK (getrusage (RUSAGE_SELF, &ru) == 0, "getrusage(RUSAGE_SELF)");
+  CHECK (ru.read_bytes >= sizeof sample - 1, "exited thread's reads counted");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-rusage) begin
+(thread-rusage) open "sample.txt"
+(thread-rusage) thread_create
+(thread-rusage) thread_join
+(thread-rusage) thread counts main thread's output
+(thread-rusage) thread read "sample.txt"
+(thread-rusage) getrusage(RUSAGE_SELF)
+(thread-rusage) exited thread's reads counted
+(thread-rusage) end
+thread-rusage: exit(0)
+EOF
+pass;
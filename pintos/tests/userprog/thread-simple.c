@@ -0,0 +1,52 @@
+/* Starts threads that fill in a shared array and open a file,
+   then joins them and checks that the array, the descriptor and
+   their exit statuses are all visible to the main thread. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/sample.inc"
+
+#define THREAD_CNT 4
+
+static int slots[THREAD_CNT];
+static int sample_fd = -1;
+
+static void
+worker (void *aux)
+{
+  int i = (long) aux;
+
+  slots[i] = i + 1;
+  if (i == 0)
+    sample_fd = open ("sample.txt");
+  else
+    thread_exit (i * 10);
+}
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample - 1];
+  tid_t tids[THREAD_CNT];
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = thread_create (worker, (void *) (long) i)) != TID_ERROR,
+           "thread_create %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (thread_join (tids[i]) == i * 10, "thread_join %d", i);
+  CHECK (thread_join (tids[0]) == -1, "thread_join 0 again fails");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (slots[i] != i + 1)
+      fail ("slots[%d] = %d", i, slots[i]);
+  msg ("threads share memory");
+
+  CHECK (sample_fd > 1, "thread opened \"sample.txt\"");
+  CHECK (read (sample_fd, buf, sizeof buf) == (int) sizeof buf,
+         "read \"sample.txt\" through its descriptor");
+  if (memcmp (buf, sample, sizeof buf))
+    fail ("read wrong data");
+}
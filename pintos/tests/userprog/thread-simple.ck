@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-simple) begin
+(thread-simple) thread_create 0
+(thread-simple) thread_create 1
+(thread-simple) thread_create 2
+(thread-simple) thread_create 3
+(thread-simple) thread_join 0
+(thread-simple) thread_join 1
+(thread-simple) thread_join 2
+(thread-simple) thread_join 3
+(thread-simple) thread_join 0 again fails
+(thread-simple) threads share memory
+(thread-simple) thread opened "sample.txt"
+(thread-simple) read "sample.txt" through its descriptor
+(thread-simple) end
+thread-simple: exit(0)
+EOF
+pass;
@@ -20,7 +20,9 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -51,6 +53,9 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* -trace: Record kernel events? */
+static bool trace_events;
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -86,6 +91,8 @@ main (void) {
 	mem_end = palloc_init ();
 	malloc_init ();
 	paging_init (mem_end);
+	if (trace_events)
+		trace_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -221,6 +228,14 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-stride"))
+			thread_stride = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-trace"))
+			trace_events = true;
+		else if (!strcmp (name, "-lockstat"))
+			lock_profiling = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -230,6 +245,8 @@ parse_options (char **argv) {
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
+	if (thread_mlfqs && thread_stride)
+		PANIC ("-mlfqs and -stride are mutually exclusive");
 
 	return argv;
 }
@@ -326,6 +343,11 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -stride            Use stride (proportional-share) scheduler,\n"
+			"                     not with -mlfqs.\n"
+			"  -tickless          Stop the periodic timer tick while idle.\n"
+			"  -trace             Record kernel events, print them at power off.\n"
+			"  -lockstat          Profile lock contention, print it at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -343,6 +365,7 @@ power_off (void) {
 #endif
 
 	print_stats ();
+	trace_dump ();
 
 	printf ("Powering off...\n");
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
@@ -353,7 +376,9 @@ power_off (void) {
 static void
 print_stats (void) {
 	timer_print_stats ();
+	intr_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -362,4 +387,5 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+	lock_print_stats ();
 }
@@ -13,6 +13,7 @@
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #endif
 
 /* Number of x86_64 interrupts. */
@@ -103,12 +104,36 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Softirqs are the deferred halves of external interrupt
+   handlers.  A handler does only what must be done with
+   interrupts off, such as acknowledging the device, and raises a
+   softirq for the rest.  Raised softirqs run when the outermost
+   external interrupt returns, after the PIC has been
+   acknowledged, with interrupts on.  Like interrupt handlers they
+   may not sleep, and intr_context() is true while they run, but
+   other interrupts can be taken meanwhile.  A softirq raised
+   again while softirqs are running is run again before they
+   return. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+static const char *softirq_names[SOFTIRQ_CNT];
+static unsigned softirq_pending;  /* Bit N set if softirq N is raised. */
+static bool in_softirq;         /* Are we running softirqs? */
+
+/* Statistics. */
+static int64_t intr_cnt[INTR_CNT];        /* # of external interrupts. */
+static uint64_t intr_cycles[INTR_CNT];    /* TSC cycles in their handlers. */
+static uint64_t intr_max_cycles[INTR_CNT]; /* Longest single handler run. */
+static int64_t softirq_cnt[SOFTIRQ_CNT];
+static uint64_t softirq_cycles[SOFTIRQ_CNT];
+static uint64_t softirq_max_cycles[SOFTIRQ_CNT];
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
+static void softirq_run (void);
 
 /* Returns the current interrupt status. */
 enum intr_level
@@ -135,7 +160,7 @@ intr_set_level (enum intr_level level) {
 enum intr_level
 intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
-	ASSERT (!intr_context ());
+	ASSERT (!in_external_intr);
 
 	/* Enable interrupts by setting the interrupt flag.
 
@@ -252,22 +277,80 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or of
+   softirqs and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	return in_external_intr || in_softirq;
 }
 
-/* During processing of an external interrupt, directs the
-   interrupt handler to yield to a new process just before
-   returning from the interrupt.  May not be called at any other
-   time. */
+/* During processing of an external interrupt or of softirqs,
+   directs the interrupt handler to yield to a new process just
+   before returning from the interrupt.  May not be called at any
+   other time. */
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
 	yield_on_return = true;
 }
+
+/* Registers HANDLER to run when softirq NR is raised.  NAME is
+   for debugging purposes. */
+void
+softirq_register (enum softirq nr, softirq_func *handler, const char *name) {
+	ASSERT (nr < SOFTIRQ_CNT);
+	ASSERT (softirq_handlers[nr] == NULL);
+
+	softirq_handlers[nr] = handler;
+	softirq_names[nr] = name;
+}
+
+/* Marks softirq NR to run when the current external interrupt
+   returns.  Meant to be called from an external interrupt
+   handler or a softirq; if called elsewhere, NR runs on return
+   from the next external interrupt. */
+void
+softirq_raise (enum softirq nr) {
+	enum intr_level old_level;
+
+	ASSERT (nr < SOFTIRQ_CNT);
+
+	old_level = intr_disable ();
+	softirq_pending |= 1u << nr;
+	intr_set_level (old_level);
+}
+
+/* Runs raised softirqs with interrupts on, until none is left
+   raised.  Called with interrupts off at the end of an external
+   interrupt that did not interrupt softirqs; returns with them
+   off. */
+static void
+softirq_run (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!in_external_intr && !in_softirq);
+
+	in_softirq = true;
+	while (softirq_pending != 0) {
+		unsigned pending = softirq_pending;
+		int nr;
+
+		softirq_pending = 0;
+		intr_enable ();
+		for (nr = 0; nr < SOFTIRQ_CNT; nr++)
+			if (pending & (1u << nr)) {
+				uint64_t start = rdtsc (), cycles;
+
+				softirq_handlers[nr] ();
+				cycles = rdtsc () - start;
+				softirq_cnt[nr]++;
+				softirq_cycles[nr] += cycles;
+				if (cycles > softirq_max_cycles[nr])
+					softirq_max_cycles[nr] = cycles;
+			}
+		intr_disable ();
+	}
+	in_softirq = false;
+}
 
 /* 8259A Programmable Interrupt Controller. */
 
@@ -340,15 +423,31 @@ intr_handler (struct intr_frame *frame) {
 	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (!intr_context ());
+		/* May interrupt softirqs, but not another interrupt. */
+		ASSERT (!in_external_intr);
 
 		in_external_intr = true;
-		yield_on_return = false;
+		if (!in_softirq)
+			yield_on_return = false;
+
+		/* A device may have woken us out of a tickless idle
+		   period.  Bring the tick counter up to date first. */
+		if (frame->vec_no != 0x20)
+			timer_idle_exit ();
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
-	if (handler != NULL)
+	if (handler != NULL && external) {
+		uint64_t start = rdtsc (), cycles;
+
+		handler (frame);
+		cycles = rdtsc () - start;
+		intr_cnt[frame->vec_no]++;
+		intr_cycles[frame->vec_no] += cycles;
+		if (cycles > intr_max_cycles[frame->vec_no])
+			intr_max_cycles[frame->vec_no] = cycles;
+	} else if (handler != NULL)
 		handler (frame);
 	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
 		/* There is no handler, but this interrupt can trigger
@@ -364,13 +463,25 @@ intr_handler (struct intr_frame *frame) {
 	/* Complete the processing of an external interrupt. */
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
-		ASSERT (intr_context ());
+		ASSERT (in_external_intr);
 
 		in_external_intr = false;
 		pic_end_of_interrupt (frame->vec_no);
 
+		/* An interrupt taken while softirqs run returns to them,
+		   which yield on return themselves. */
+		if (in_softirq)
+			return;
+		if (softirq_pending != 0)
+			softirq_run ();
 		if (yield_on_return)
-			thread_yield ();
+			thread_yield_preempted ();
+#ifdef USERPROG
+		/* A thread spinning in user mode learns here that another
+		   thread of its process has called exit(). */
+		if (frame->cs == SEL_UCSEG)
+			process_check_exit ();
+#endif
 	}
 }
 
@@ -403,3 +514,21 @@ const char *
 intr_name (uint8_t vec) {
 	return intr_names[vec];
 }
+
+/* Prints the time spent in each external interrupt handler, with
+   interrupts off, and in each softirq, with them on. */
+void
+intr_print_stats (void) {
+	int i;
+
+	for (i = 0x20; i < 0x30; i++)
+		if (intr_cnt[i] > 0)
+			printf ("Interrupt %#04x (%s): %"PRId64" calls, %"PRIu64" cycles "
+					"(max %"PRIu64")\n", i, intr_names[i], intr_cnt[i],
+					intr_cycles[i], intr_max_cycles[i]);
+	for (i = 0; i < SOFTIRQ_CNT; i++)
+		if (softirq_cnt[i] > 0)
+			printf ("Softirq %s: %"PRId64" runs, %"PRIu64" cycles "
+					"(max %"PRIu64")\n", softirq_names[i], softirq_cnt[i],
+					softirq_cycles[i], softirq_max_cycles[i]);
+}
@@ -2,14 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +27,76 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free pages form
+   blocks of 2**ORDER pages, aligned to their size relative to the
+   pool's base, kept on one free list per order.  A request for N
+   pages takes a block of the smallest order that holds N,
+   splitting a larger one if need be, and gives back the pages
+   past N.  Freeing a block merges it with its buddy, the other
+   half of the block it was split from, for as long as the buddy
+   is free too.  Both take O(log n) steps.  The list elements are
+   kept in an array beside the pool's bitmap, one per page, so
+   free pages are never written to.
+
+   Pages are freed from inside the scheduler, with interrupts off,
+   so a pool is guarded by a spinlock rather than a lock.
+
+   Single pages, by far the most common request, mostly bypass
+   that lock.  Each pool keeps a magazine of up to MAG_SIZE free
+   pages, touched only with interrupts off.
+   An empty magazine is refilled, and a full one drained, MAG_BATCH
+   pages at a time under one acquisition of the pool lock.
+
+   Each magazine also holds up to ZERO_MAX pages already filled
+   with zeros, which serve single-page PAL_ZERO requests without a
+   memset.  The idle thread zeroes them, in
+   palloc_zero_idle(), for the pools that have seen such requests.
+   They are handed out for any request once the pool runs dry. */
+
+/* Largest block order, in pages. */
+#define MAX_ORDER 18
+
+/* `orders' entry for a page that does not begin a free block. */
+#define NO_ORDER 0xff
+
+/* Capacity of a magazine, and number of pages moved at a time
+   between a magazine and its pool. */
+#define MAG_SIZE 16
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Number of zeroed pages a magazine holds. */
+#define ZERO_MAX 32
+
+/* A cache of free pages of one pool.  Its pages are marked
+   used in the pool. */
+struct magazine {
+	void *pages[MAG_SIZE];          /* Cached pages. */
+	int cnt;                        /* Number of cached pages. */
+	uint64_t get_hits;              /* Pages handed out from cache. */
+	uint64_t get_misses;            /* Gets that had to refill. */
+	uint64_t put_hits;              /* Pages freed into cache. */
+	uint64_t put_misses;            /* Puts that had to drain. */
+
+	void *zeroed[ZERO_MAX];         /* Pages filled with zeros. */
+	int zeroed_cnt;                 /* Number of zeroed pages. */
+	uint64_t zero_hits;             /* PAL_ZERO gets served zeroed. */
+	uint64_t zero_misses;           /* PAL_ZERO gets that had to memset. */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
+	struct spinlock lock;           /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	uint8_t *orders;                /* Per page: order of the free block
+	                                   it begins, or NO_ORDER. */
+	struct list_elem *elems;        /* Per page: free list element. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+	size_t free_cnt[MAX_ORDER + 1]; /* Number of blocks in each list. */
+	size_t free_pages;              /* Number of free pages. */
+	struct magazine mag;            /* Cache of single pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +108,17 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, int order);
+static void buddy_free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void *pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *magazine_get (struct pool *);
+static void *magazine_get_zeroed (struct pool *);
+static void magazine_put (struct pool *, void *page);
+static bool magazine_flush (struct pool *);
+#ifndef NDEBUG
+static bool magazine_holds (const struct pool *, const void *page);
+#endif
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +301,15 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free_range (pool, page_idx, page_cnt);
+				pool->free_pages += page_cnt;
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free_range (pool, page_idx, page_cnt);
+				pool->free_pages += page_cnt;
 			}
 		}
 	}
@@ -262,19 +343,29 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	void *pages = NULL;
+	bool zeroed = false;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	old_level = intr_disable ();
+	if (page_cnt == 1) {
+		if (flags & PAL_ZERO)
+			pages = magazine_get_zeroed (pool);
+		zeroed = pages != NULL;
+		if (pages == NULL)
+			pages = magazine_get (pool);
+	} else {
+		spinlock_acquire (&pool->lock);
+		pages = pool_alloc (pool, page_cnt);
+		/* The pages in the magazine may be what it takes. */
+		if (pages == NULL && magazine_flush (pool))
+			pages = pool_alloc (pool, page_cnt);
+		spinlock_release (&pool->lock);
+	}
+	intr_set_level (old_level);
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -300,6 +391,7 @@ palloc_get_page (enum palloc_flags flags) {
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
+	enum intr_level old_level;
 	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
@@ -318,8 +410,17 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	old_level = intr_disable ();
+	if (page_cnt == 1) {
+		ASSERT (bitmap_test (pool->used_map, page_idx));
+		ASSERT (!magazine_holds (pool, pages));
+		magazine_put (pool, pages);
+	} else {
+		spinlock_acquire (&pool->lock);
+		pool_free (pool, page_idx, page_cnt);
+		spinlock_release (&pool->lock);
+	}
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -336,15 +437,336 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t order_pages = DIV_ROUND_UP (pgcnt, PGSIZE) * PGSIZE;
+	size_t elem_pages = DIV_ROUND_UP (pgcnt * sizeof (struct list_elem),
+			PGSIZE) * PGSIZE;
+	int order;
 
-	lock_init(&p->lock);
+	spinlock_init (&p->lock);
+	memset (&p->mag, 0, sizeof p->mag);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->orders = (uint8_t *) *bm_base + bm_pages;
+	p->elems = (struct list_elem *) (p->orders + order_pages);
+	for (order = 0; order <= MAX_ORDER; order++) {
+		list_init (&p->free_lists[order]);
+		p->free_cnt[order] = 0;
+	}
+	p->free_pages = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->orders, NO_ORDER, pgcnt);
+
+	*bm_base += bm_pages + order_pages + elem_pages;
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX on POOL's free
+   list for ORDER. */
+static void
+block_push (struct pool *pool, size_t page_idx, int order) {
+	pool->orders[page_idx] = order;
+	list_push_front (&pool->free_lists[order], &pool->elems[page_idx]);
+	pool->free_cnt[order]++;
+}
+
+/* Takes the free block at PAGE_IDX off POOL's free list for its
+   order. */
+static void
+block_remove (struct pool *pool, size_t page_idx) {
+	int order = pool->orders[page_idx];
+
+	list_remove (&pool->elems[page_idx]);
+	pool->free_cnt[order]--;
+	pool->orders[page_idx] = NO_ORDER;
+}
+
+/* Removes a free block of 2**ORDER pages from POOL and returns the
+   index of its first page, or BITMAP_ERROR if there is none. */
+static size_t
+buddy_alloc (struct pool *pool, int order) {
+	size_t page_idx;
+	int o;
+
+	ASSERT (spinlock_held_by_current_thread (&pool->lock));
+
+	for (o = order; o <= MAX_ORDER; o++)
+		if (!list_empty (&pool->free_lists[o]))
+			break;
+	if (o > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_front (&pool->free_lists[o]) - pool->elems;
+	block_remove (pool, page_idx);
+
+	/* Split it down to ORDER, freeing the upper halves. */
+	while (o > order) {
+		o--;
+		block_push (pool, page_idx + ((size_t) 1 << o), o);
+	}
+	return page_idx;
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, first merging it with its buddy for as long as the buddy
+   is free. */
+static void
+buddy_free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy + ((size_t) 1 << order) > page_cnt
+				|| pool->orders[buddy] != order)
+			break;
+		block_remove (pool, buddy);
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	block_push (pool, page_idx, order);
+}
+
+/* Adds the PAGE_CNT pages at PAGE_IDX to POOL's free lists, as the
+   fewest blocks they can be split into. */
+static void
+buddy_free_range (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& (page_idx & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT pages from POOL, which must be locked, and
+   returns the first, or a null pointer if it has no run of
+   PAGE_CNT free pages. */
+static void *
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+	int order = 0;
+
+	ASSERT (spinlock_held_by_current_thread (&pool->lock));
+
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+	if (page_cnt == 0 || order > MAX_ORDER)
+		return NULL;
+	page_idx = buddy_alloc (pool, order);
+	if (page_idx == BITMAP_ERROR)
+		return NULL;
+
+	/* Give back the pages past PAGE_CNT. */
+	buddy_free_range (pool, page_idx + page_cnt,
+			((size_t) 1 << order) - page_cnt);
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	pool->free_pages -= page_cnt;
+	return pool->base + PGSIZE * page_idx;
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX to POOL, which must be
+   locked. */
+static void
+pool_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	ASSERT (spinlock_held_by_current_thread (&pool->lock));
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free_range (pool, page_idx, page_cnt);
+	pool->free_pages += page_cnt;
+}
+
+/* Takes a page from POOL's magazine, refilling it first if it
+   is empty.  Returns a null pointer if POOL is out
+   of pages too. */
+static void *
+magazine_get (struct pool *pool) {
+	struct magazine *m = &pool->mag;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (m->cnt > 0)
+		m->get_hits++;
+	else {
+		m->get_misses++;
+		spinlock_acquire (&pool->lock);
+		while (m->cnt < MAG_BATCH) {
+			void *page = pool_alloc (pool, 1);
+			if (page == NULL)
+				break;
+			m->pages[m->cnt++] = page;
+		}
+		spinlock_release (&pool->lock);
+		if (m->cnt == 0)
+			return m->zeroed_cnt > 0 ? m->zeroed[--m->zeroed_cnt] : NULL;
+	}
+	return m->pages[--m->cnt];
+}
 
-	*bm_base += bm_pages;
+/* Takes a zeroed page from POOL's magazine, or returns a null
+   pointer if it has none. */
+static void *
+magazine_get_zeroed (struct pool *pool) {
+	struct magazine *m = &pool->mag;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (m->zeroed_cnt == 0) {
+		m->zero_misses++;
+		return NULL;
+	}
+	m->zero_hits++;
+	return m->zeroed[--m->zeroed_cnt];
+}
+
+/* Puts PAGE in POOL's magazine, draining it first if it is
+   full. */
+static void
+magazine_put (struct pool *pool, void *page) {
+	struct magazine *m = &pool->mag;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (m->cnt < MAG_SIZE)
+		m->put_hits++;
+	else {
+		m->put_misses++;
+		spinlock_acquire (&pool->lock);
+		while (m->cnt > MAG_BATCH)
+			pool_free (pool, pg_no (m->pages[--m->cnt]) - pg_no (pool->base), 1);
+		spinlock_release (&pool->lock);
+	}
+	m->pages[m->cnt++] = page;
+}
+
+/* Returns all the pages in POOL's magazine, zeroed or not, to
+   POOL, which must be locked.  Returns true if there were any. */
+static bool
+magazine_flush (struct pool *pool) {
+	struct magazine *m = &pool->mag;
+	bool flushed = m->cnt > 0 || m->zeroed_cnt > 0;
+
+	ASSERT (spinlock_held_by_current_thread (&pool->lock));
+
+	while (m->cnt > 0)
+		pool_free (pool, pg_no (m->pages[--m->cnt]) - pg_no (pool->base), 1);
+	while (m->zeroed_cnt > 0)
+		pool_free (pool, pg_no (m->zeroed[--m->zeroed_cnt])
+				- pg_no (pool->base), 1);
+	return flushed;
+}
+
+#ifndef NDEBUG
+/* Returns true if PAGE is cached, zeroed or not, in POOL's
+   magazine.  Cached pages are marked used in the pool, so this is
+   how a double free of a single page is caught. */
+static bool
+magazine_holds (const struct pool *pool, const void *page) {
+	const struct magazine *m = &pool->mag;
+	int i;
+
+	for (i = 0; i < m->cnt; i++)
+		if (m->pages[i] == page)
+			return true;
+	for (i = 0; i < m->zeroed_cnt; i++)
+		if (m->zeroed[i] == page)
+			return true;
+	return false;
+}
+#endif
+
+/* Zeroes a free page of POOL for its magazine, if POOL has seen
+   PAL_ZERO requests and the magazine has room.  Returns true if
+   it did. */
+static bool
+zero_free_page (struct pool *pool) {
+	enum intr_level old_level;
+	struct magazine *m;
+	void *page = NULL;
+
+	old_level = intr_disable ();
+	m = &pool->mag;
+	if (m->zero_hits + m->zero_misses > 0 && m->zeroed_cnt < ZERO_MAX) {
+		spinlock_acquire (&pool->lock);
+		page = pool_alloc (pool, 1);
+		spinlock_release (&pool->lock);
+	}
+	intr_set_level (old_level);
+	if (page == NULL)
+		return false;
+
+	memset (page, 0, PGSIZE);
+
+	old_level = intr_disable ();
+	if (m->zeroed_cnt < ZERO_MAX)
+		m->zeroed[m->zeroed_cnt++] = page;
+	else
+		magazine_put (pool, page);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Zeroes a free page for PAL_ZERO requests, with interrupts on,
+   if any pool needs one.  Returns true if it did,
+   false if there is nothing to do.  Called by the idle thread. */
+bool
+palloc_zero_idle (void) {
+	return zero_free_page (&kernel_pool) || zero_free_page (&user_pool);
+}
+
+/* Prints the number of free pages in POOL, called NAME, its
+   number of free blocks of each order and how often its
+   magazine served single pages without taking its lock. */
+static void
+print_pool_stats (struct pool *pool, const char *name) {
+	const struct magazine *m = &pool->mag;
+	enum intr_level old_level;
+	size_t free_cnt[MAX_ORDER + 1];
+	size_t free_pages, cached, zeroed;
+	uint64_t gets, get_hits, puts, put_hits, zero_gets, zero_hits;
+	int order, top;
+
+	old_level = intr_disable ();
+	spinlock_acquire (&pool->lock);
+	memcpy (free_cnt, pool->free_cnt, sizeof free_cnt);
+	free_pages = pool->free_pages;
+	spinlock_release (&pool->lock);
+	cached = m->cnt;
+	zeroed = m->zeroed_cnt;
+	zero_hits = m->zero_hits;
+	zero_gets = m->zero_hits + m->zero_misses;
+	get_hits = m->get_hits;
+	gets = m->get_hits + m->get_misses;
+	put_hits = m->put_hits;
+	puts = m->put_hits + m->put_misses;
+	intr_set_level (old_level);
+
+	for (top = MAX_ORDER; top > 0 && free_cnt[top] == 0; top--)
+		continue;
+	printf ("%s pool: %zu of %zu pages free, %zu cached, %zu zeroed, "
+			"blocks by order:", name, free_pages,
+			bitmap_size (pool->used_map), cached, zeroed);
+	for (order = 0; order <= top; order++)
+		printf (" %zu", free_cnt[order]);
+	printf ("\n");
+	printf ("%s pool magazine: %"PRIu64" of %"PRIu64" gets and "
+			"%"PRIu64" of %"PRIu64" puts hit\n",
+			name, get_hits, gets, put_hits, puts);
+	printf ("%s pool: %"PRIu64" of %"PRIu64" PAL_ZERO pages "
+			"were zeroed ahead\n", name, zero_hits, zero_gets);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats (&kernel_pool, "Kernel");
+	print_pool_stats (&user_pool, "User");
 }
 
 /* Returns true if PAGE was allocated from POOL,
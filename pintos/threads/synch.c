@@ -27,10 +27,117 @@
    */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+static bool waitq_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void lock_take (struct lock *, struct thread *);
+static void lock_class_register (struct lock_class *);
+static void donation_refresh (struct thread *);
+static void rwlock_donate (struct rwlock *);
+
+/* Initializes wait queue Q as empty. */
+void
+waitq_init (struct waitq *q) {
+	ASSERT (q != NULL);
+
+	heap_init (&q->heap, waitq_less, NULL);
+	q->next_seq = 0;
+}
+
+/* Adds thread T to Q, using E, which must stay in place until it
+   is popped. */
+void
+waitq_push (struct waitq *q, struct waitq_elem *e, struct thread *t) {
+	ASSERT (q != NULL && e != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	e->thread = t;
+	e->seq = q->next_seq++;
+	e->queue = q;
+	list_push_back (&t->waitq_elems, &e->thread_elem);
+	heap_insert (&q->heap, &e->heap_elem);
+}
+
+/* Removes and returns the entry of the highest priority waiter
+   in Q, or returns a null pointer if Q is empty. */
+struct waitq_elem *
+waitq_pop (struct waitq *q) {
+	struct heap_elem *h;
+	struct waitq_elem *e;
+
+	ASSERT (q != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	h = heap_pop_min (&q->heap);
+	if (h == NULL)
+		return NULL;
+	e = waitq_entry (h, struct waitq_elem, heap_elem);
+	list_remove (&e->thread_elem);
+	e->queue = NULL;
+	return e;
+}
+
+/* Removes E, which must be in a queue, from that queue. */
+void
+waitq_remove (struct waitq_elem *e) {
+	ASSERT (e != NULL && e->queue != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	heap_remove (&e->queue->heap, &e->heap_elem);
+	list_remove (&e->thread_elem);
+	e->queue = NULL;
+}
+
+/* Returns the entry of the highest priority waiter in Q without
+   removing it, or a null pointer if Q is empty. */
+struct waitq_elem *
+waitq_front (const struct waitq *q) {
+	struct heap_elem *h = heap_min (&q->heap);
+
+	return h != NULL ? waitq_entry (h, struct waitq_elem, heap_elem) : NULL;
+}
+
+/* Returns true if nobody waits in Q. */
+bool
+waitq_empty (const struct waitq *q) {
+	return heap_empty (&q->heap);
+}
+
+/* Restores the order of every wait queue T is in, after T's
+   priority changed. */
+void
+waitq_rekey (struct thread *t) {
+	struct list_elem *le;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (le = list_begin (&t->waitq_elems); le != list_end (&t->waitq_elems);
+			le = list_next (le)) {
+		struct waitq_elem *e = list_entry (le, struct waitq_elem, thread_elem);
+		heap_update (&e->queue->heap, &e->heap_elem);
+	}
+}
+
+/* Orders wait queue entries by descending priority of the waiting
+   thread, then by arrival. */
+static bool
+waitq_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct waitq_elem *a = waitq_entry (a_, struct waitq_elem, heap_elem);
+	const struct waitq_elem *b = waitq_entry (b_, struct waitq_elem, heap_elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority > b->thread->priority;
+	return a->seq < b->seq;
+}
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +153,9 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	waitq_init (&sema->waiters);
+	sema->waits = 0;
+	sema->wait_cycles = 0;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -65,11 +174,16 @@ sema_down (struct semaphore *sema) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	list_sort(&sema->waiters, less_priority, 0);
-	while (sema->value == 0) { 
-		//list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema->waiters, &thread_current()->elem, less_priority, 0);
-		thread_block ();
+	if (sema->value == 0) {
+		uint64_t start = rdtsc ();
+		struct waitq_elem waiter;
+
+		while (sema->value == 0) { 
+			waitq_push (&sema->waiters, &waiter, thread_current ());
+			thread_block ();
+		}
+		sema->waits++;
+		sema->wait_cycles += rdtsc () - start;
 	}
 	sema->value--;
 	intr_set_level (old_level);
@@ -110,11 +224,9 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 	old_level = intr_disable ();
 
-	list_sort(&sema->waiters, less_priority, 0);
 	sema->value++;
-	if (!list_empty (&sema->waiters))
-		thread_treason (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem)); //Is it okay to just change order and block to treason??
+	if (!waitq_empty (&sema->waiters))
+		thread_treason (waitq_pop (&sema->waiters)->thread); //Is it okay to just change order and block to treason??
 
 	intr_set_level (old_level);
 }
@@ -168,13 +280,248 @@ sema_test_helper (void *sema_) {
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   Use the lock_init() macro rather than calling this directly; it
+   supplies a CLASS for each call site. */
 void
-lock_init (struct lock *lock) {
+lock_init_class (struct lock *lock, struct lock_class *class) {
 	ASSERT (lock != NULL);
+	ASSERT (class != NULL);
 
 	lock->holder = NULL;
+	lock->donation.priority = PRI_MIN - 1;
 	sema_init (&lock->semaphore, 1);
+	lock->class = class;
+	lock->acquire_tsc = 0;
+	if (!class->registered)
+		lock_class_register (class);
+}
+
+/* Lock profiling.
+
+   With the -lockstat option, each lock class counts how often its
+   locks, or spinlocks, are acquired and how long they are waited
+   for and held.
+   The four threads that waited longest, by name, are kept as
+   well.  Statistics are per class rather than per lock because a
+   lock may be freed before they are printed at power off, while a
+   class, being static, lives forever. */
+
+/* Collect statistics on lock classes?  Set by -lockstat. */
+bool lock_profiling;
+
+/* All lock classes that have initialized a lock.  Initialized
+   statically because locks are initialized from the very start. */
+static struct list lock_classes = {
+	.head = { .prev = NULL, .next = &lock_classes.tail },
+	.tail = { .prev = &lock_classes.head, .next = NULL },
+};
+
+/* Adds CLASS to the list of all lock classes. */
+static void
+lock_class_register (struct lock_class *class) {
+	enum intr_level old_level = intr_disable ();
+
+	if (!class->registered) {
+		class->registered = true;
+		list_push_back (&lock_classes, &class->elem);
+	}
+	intr_set_level (old_level);
+}
+
+/* Counts an acquisition of a lock of CLASS by T, which waited
+   WAIT cycles for it if CONTENDED.  Stores the time of
+   acquisition in *ACQUIRE_TSC. */
+static void
+lock_profile_acquire (struct lock_class *class, uint64_t *acquire_tsc,
+		const struct thread *t, bool contended, uint64_t wait) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	*acquire_tsc = rdtsc ();
+	class->acquisitions++;
+	if (!contended)
+		return;
+
+	class->contended++;
+	class->wait_cycles += wait;
+	if (wait > class->max_wait_cycles)
+		class->max_wait_cycles = wait;
+
+	/* Charge T, or else replace the waiter that waited least. */
+	struct lock_waiter *slot = &class->top_waiters[0];
+	for (int i = 0; i < LOCK_TOP_WAITERS; i++) {
+		struct lock_waiter *w = &class->top_waiters[i];
+		if (!strcmp (w->name, t->name)) {
+			w->wait_cycles += wait;
+			return;
+		}
+		if (w->wait_cycles < slot->wait_cycles)
+			slot = w;
+	}
+	if (wait > slot->wait_cycles) {
+		strlcpy (slot->name, t->name, sizeof slot->name);
+		slot->wait_cycles = wait;
+	}
+}
+
+/* Counts the end of the current hold of a lock of CLASS, which
+   was acquired at *ACQUIRE_TSC. */
+static void
+lock_profile_release (struct lock_class *class, uint64_t *acquire_tsc) {
+	uint64_t hold;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (*acquire_tsc == 0)
+		return;
+	hold = rdtsc () - *acquire_tsc;
+	*acquire_tsc = 0;
+	class->hold_cycles += hold;
+	if (hold > class->max_hold_cycles)
+		class->max_hold_cycles = hold;
+}
+
+/* Orders lock classes by descending total wait time. */
+static bool
+lock_class_waited_more (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct lock_class *a = list_entry (a_, struct lock_class, elem);
+	const struct lock_class *b = list_entry (b_, struct lock_class, elem);
+
+	return a->wait_cycles > b->wait_cycles;
+}
+
+/* Converts CYCLES to microseconds. */
+static uint64_t
+cycles_to_us (uint64_t cycles) {
+	return timer_cycles_to_ns (cycles) / 1000;
+}
+
+/* Prints the statistics of every lock class that was used, the
+   ones waited for longest first. */
+void
+lock_print_stats (void) {
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	if (!lock_profiling)
+		return;
+
+	old_level = intr_disable ();
+	list_sort (&lock_classes, lock_class_waited_more, NULL);
+	intr_set_level (old_level);
+
+	printf ("Locks, by time waited:\n");
+	for (e = list_begin (&lock_classes); e != list_end (&lock_classes);
+			e = list_next (e)) {
+		struct lock_class *c = list_entry (e, struct lock_class, elem);
+		int i;
+
+		if (c->acquisitions == 0)
+			continue;
+		printf ("  %s (%s:%d): %"PRIu64" acquired, %"PRIu64" contended, "
+				"waited %"PRIu64" us (max %"PRIu64"), "
+				"held %"PRIu64" us (max %"PRIu64")\n",
+				c->name, c->file, c->line, c->acquisitions, c->contended,
+				cycles_to_us (c->wait_cycles), cycles_to_us (c->max_wait_cycles),
+				cycles_to_us (c->hold_cycles), cycles_to_us (c->max_hold_cycles));
+		for (i = 0; i < LOCK_TOP_WAITERS; i++) {
+			const struct lock_waiter *w = &c->top_waiters[i];
+			if (w->name[0] != '\0')
+				printf ("    waiter %s: %"PRIu64" us\n", w->name,
+						cycles_to_us (w->wait_cycles));
+		}
+	}
+}
+
+/* Priority donation.
+
+   The threads waiting for a lock donate their priority to its
+   holder.  The lock's semaphore wait queue is a heap of donors,
+   and its struct donation caches the priority of the top waiter.
+   Each thread keeps the donations made to it, one per lock it
+   holds, in a heap, so a thread's effective priority, the higher
+   of its own and its best donor's, is found in constant time.
+   Reader-writer locks donate the same way, to the writer or to
+   each reader.
+
+   When the top waiter of a lock changes, the change is pushed
+   along the wait-for chain: the holder's priority is recomputed,
+   which re-sorts it in the queue of the lock it is waiting for in
+   turn, and so on until a priority stays the same.  There is no
+   depth limit, and each step costs O(log n). */
+
+/* Orders donations by descending priority. */
+bool
+donation_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct donation *a = heap_entry (a_, struct donation, elem);
+	const struct donation *b = heap_entry (b_, struct donation, elem);
+
+	return a->priority > b->priority;
+}
+
+/* Returns the priority of T including donations. */
+int
+lock_effective_priority (const struct thread *t) {
+	struct heap_elem *top = heap_min (&t->held_locks);
+	int priority = t->priority_origin;
+
+	if (top != NULL) {
+		int donated = heap_entry (top, struct donation, elem)->priority;
+		if (donated > priority)
+			priority = donated;
+	}
+	return priority;
+}
+
+/* Returns the priority of the top waiter in Q, or PRI_MIN - 1 if
+   nobody waits. */
+static int
+waitq_top_priority (const struct waitq *q) {
+	struct waitq_elem *top = waitq_front (q);
+
+	return top != NULL ? top->thread->priority : PRI_MIN - 1;
+}
+
+/* Sets donation D, made to HOLDER, to PRIORITY and pushes the
+   change along the wait-for chain. */
+static void
+donation_set (struct donation *d, struct thread *holder, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (priority == d->priority)
+		return;
+	d->priority = priority;
+	if (holder != NULL) {
+		heap_update (&holder->held_locks, &d->elem);
+		donation_refresh (holder);
+	}
+}
+
+/* Recomputes the priority of T after the donations made to it
+   changed, and passes a change on to whatever T waits for. */
+static void
+donation_refresh (struct thread *t) {
+	int priority;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_mlfqs)
+		return;
+	priority = lock_effective_priority (t);
+	if (priority == t->priority)
+		return;
+	t->priority = priority;
+	thread_requeue (t);
+
+	if (t->pressing_lock != NULL) {
+		struct lock *lock = t->pressing_lock;
+		donation_set (&lock->donation, lock->holder,
+				waitq_top_priority (&lock->semaphore.waiters));
+	} else if (t->pressing_rwlock != NULL)
+		rwlock_donate (t->pressing_rwlock);
 }
 
 
@@ -188,36 +535,45 @@ lock_init (struct lock *lock) {
    we need to sleep. */
 void
 lock_acquire (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	uint64_t start = 0;
+	bool contended;
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
-	if(!thread_mlfqs){
-
-	if (lock->holder != NULL){
-		struct thread * curr = thread_current(); 
-		thread_current()->pressing_lock = lock;
-		list_insert_ordered(&(lock->holder->donated_thread_list), &(curr->donated_elem), less_donated_priority, 0);
-		donate_priority(lock->holder, curr->priority);
-	}
 
+	old_level = intr_disable ();
+	contended = lock->semaphore.value == 0;
+	if (contended && lock_profiling)
+		start = rdtsc ();
+	if (lock->holder != NULL) {
+		curr->pressing_lock = lock;
+		/* sema_down() is about to make us a waiter. */
+		if (!thread_mlfqs && curr->priority > lock->donation.priority)
+			donation_set (&lock->donation, lock->holder, curr->priority);
 	}
 	sema_down (&lock->semaphore);
-	thread_current()->pressing_lock = NULL;
-	lock->holder = thread_current ();
+	curr->pressing_lock = NULL;
+	lock_take (lock, curr);
+	if (lock_profiling)
+		lock_profile_acquire (lock->class, &lock->acquire_tsc, curr, contended,
+				rdtsc () - start);
+	intr_set_level (old_level);
 }
 
-void
-donate_priority (struct thread* holder, int new_priority){
-	if ((new_priority >= holder->priority) && (new_priority > holder->priority_origin)){ 
-		holder->priority=new_priority;
-		int level= 0; 
-		struct thread * now_holder = holder;
-		while ( level<7 && now_holder->pressing_lock!=NULL ){
-			now_holder= now_holder->pressing_lock->holder;
-			now_holder->priority = new_priority;
-			level++;
-		}
-	}
+/* Makes T the holder of LOCK, whose semaphore T has just downed.
+   T inherits the donations of the threads still waiting. */
+static void
+lock_take (struct lock *lock, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = t;
+	lock->donation.priority = waitq_top_priority (&lock->semaphore.waiters);
+	heap_insert (&t->held_locks, &lock->donation.elem);
+	if (!thread_mlfqs)
+		t->priority = lock_effective_priority (t);
 }
 
 
@@ -229,14 +585,21 @@ donate_priority (struct thread* holder, int new_priority){
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
-		lock->holder = thread_current ();
+	if (success) {
+		lock_take (lock, thread_current ());
+		if (lock_profiling)
+			lock_profile_acquire (lock->class, &lock->acquire_tsc,
+					thread_current (), false, 0);
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -248,36 +611,24 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
-	struct thread* curr=thread_current();
-	lock->holder = NULL;
-
-	if(!thread_mlfqs){
-
-	if(!list_empty(&curr->donated_thread_list)){
-		struct list_elem* a_list_elem = list_front(&curr->donated_thread_list);
-		while (a_list_elem!=list_tail(&curr->donated_thread_list))
-		{
-			
-			struct thread* a_thread= list_entry(a_list_elem, struct thread, donated_elem);
-			if(a_thread->pressing_lock==lock){
-				list_remove(a_list_elem);
-			}
-			a_list_elem=a_list_elem->next;
-		}
-		
-		if(list_empty(&curr->donated_thread_list)){
-	    	curr->priority=curr->priority_origin;
-		}
-		else{
-			list_sort(&curr->donated_thread_list,less_donated_priority,0);
- 			curr->priority=list_entry(list_front(&curr->donated_thread_list), struct thread, donated_elem)->priority;
-		}
-	}
 
+	/* Give back the donations that came through LOCK. */
+	old_level = intr_disable ();
+	if (lock_profiling)
+		lock_profile_release (lock->class, &lock->acquire_tsc);
+	lock->holder = NULL;
+	heap_remove (&curr->held_locks, &lock->donation.elem);
+	if (!thread_mlfqs) {
+		curr->priority = lock_effective_priority (curr);
+		thread_requeue (curr);
 	}
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 
@@ -290,10 +641,500 @@ lock_held_by_current_thread (const struct lock *lock) {
 
 	return lock->holder == thread_current ();
 }
+
+/* Initializes reader-writer lock RW, which starts out free.
+
+   Readers share RW, a writer holds it alone.  To keep writers
+   from starving, a reader is admitted only while no writer holds
+   or waits for the lock.  When it is freed, RW is handed over
+   directly: to the waiting upgrader once it is the last reader,
+   else to the highest priority writer, else to all the waiting
+   readers at once.  Waiters donate their priority to the writer,
+   or to every reader, as with locks. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->writer = NULL;
+	rw->write_donation.priority = PRI_MIN - 1;
+	list_init (&rw->readers);
+	rw->reader_cnt = 0;
+	rw->upgrader = NULL;
+	waitq_init (&rw->readers_q);
+	waitq_init (&rw->writers_q);
+}
+
+/* Returns T's read hold on RW, or a null pointer if T does not
+   hold RW for reading. */
+static struct rwlock_hold *
+rwlock_find_hold (const struct rwlock *rw, const struct thread *t) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+			e = list_next (e)) {
+		struct rwlock_hold *h = list_entry (e, struct rwlock_hold, elem);
+		if (h->thread == t)
+			return h;
+	}
+	return NULL;
+}
+
+/* Returns the highest priority among the threads waiting for RW,
+   other than EXCLUDE, or PRI_MIN - 1 if there are none. */
+static int
+rwlock_top_priority (const struct rwlock *rw, const struct thread *exclude) {
+	int priority = waitq_top_priority (&rw->writers_q);
+	int reader = waitq_top_priority (&rw->readers_q);
+
+	if (reader > priority)
+		priority = reader;
+	if (rw->upgrader != NULL && rw->upgrader != exclude
+			&& rw->upgrader->priority > priority)
+		priority = rw->upgrader->priority;
+	return priority;
+}
+
+/* Brings the donations RW makes to its writer or readers up to
+   date with the threads waiting for it.  An upgrading reader does
+   not donate to itself. */
+static void
+rwlock_donate (struct rwlock *rw) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rw->writer != NULL)
+		donation_set (&rw->write_donation, rw->writer,
+				rwlock_top_priority (rw, NULL));
+	for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+			e = list_next (e)) {
+		struct rwlock_hold *h = list_entry (e, struct rwlock_hold, elem);
+		donation_set (&h->donation, h->thread,
+				rwlock_top_priority (rw, h->thread));
+	}
+}
+
+/* Gives T a read hold on RW, recorded in H. */
+static void
+rwlock_take_read (struct rwlock *rw, struct rwlock_hold *h,
+		struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	h->lock = rw;
+	h->thread = t;
+	h->donation.priority = PRI_MIN - 1;
+	list_push_back (&rw->readers, &h->elem);
+	rw->reader_cnt++;
+	heap_insert (&t->held_locks, &h->donation.elem);
+	t->pressing_rwlock = NULL;
+}
+
+/* Takes T's read hold on RW away. */
+static void
+rwlock_drop_read (struct rwlock *rw, struct thread *t) {
+	struct rwlock_hold *h = rwlock_find_hold (rw, t);
+
+	ASSERT (h != NULL);
+
+	list_remove (&h->elem);
+	rw->reader_cnt--;
+	heap_remove (&t->held_locks, &h->donation.elem);
+}
+
+/* Makes T the writer of RW. */
+static void
+rwlock_take_write (struct rwlock *rw, struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (rw->writer == NULL && rw->reader_cnt == 0);
+
+	rw->writer = t;
+	rw->write_donation.priority = PRI_MIN - 1;
+	heap_insert (&t->held_locks, &rw->write_donation.elem);
+	t->pressing_rwlock = NULL;
+}
+
+/* Takes the write hold on RW away from its writer. */
+static void
+rwlock_drop_write (struct rwlock *rw) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	heap_remove (&rw->writer->held_locks, &rw->write_donation.elem);
+	rw->writer = NULL;
+}
+
+/* Hands RW to the threads that should get it next, if any, and
+   wakes them up. */
+static void
+rwlock_grant (struct rwlock *rw) {
+	struct waitq_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rw->writer != NULL)
+		return;
+	if (rw->upgrader != NULL) {
+		if (rw->reader_cnt == 1) {
+			struct thread *t = rw->upgrader;
+
+			rw->upgrader = NULL;
+			rwlock_drop_read (rw, t);
+			rwlock_take_write (rw, t);
+			thread_unblock (t);
+		}
+	} else if (rw->reader_cnt == 0
+			&& (e = waitq_pop (&rw->writers_q)) != NULL) {
+		rwlock_take_write (rw, e->thread);
+		thread_unblock (e->thread);
+	} else if (waitq_empty (&rw->writers_q)) {
+		while ((e = waitq_pop (&rw->readers_q)) != NULL) {
+			struct rwlock_hold *h = waitq_entry (e, struct rwlock_hold, waiter);
+			rwlock_take_read (rw, h, e->thread);
+			thread_unblock (e->thread);
+		}
+	}
+}
+
+/* Finishes an operation that gave up some hold on RW: passes RW
+   on and recomputes the donations it makes, including what the
+   current thread lost. */
+static void
+rwlock_settle (struct rwlock *rw) {
+	rwlock_grant (rw);
+	rwlock_donate (rw);
+	donation_refresh (thread_current ());
+}
+
+/* Blocks the current thread until another thread hands RW over
+   to it.  If E is nonnull, the thread waits in queue Q. */
+static void
+rwlock_wait (struct rwlock *rw, struct waitq *q, struct waitq_elem *e) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (e != NULL)
+		waitq_push (q, e, curr);
+	curr->pressing_rwlock = rw;
+	if (!thread_mlfqs)
+		rwlock_donate (rw);
+	thread_block ();
+	ASSERT (curr->pressing_rwlock == NULL);
+}
+
+/* Returns true if a new reader may enter RW right away. */
+static bool
+rwlock_read_ready (const struct rwlock *rw) {
+	return rw->writer == NULL && rw->upgrader == NULL
+		&& waitq_empty (&rw->writers_q);
+}
+
+/* Returns true if a writer may enter RW right away. */
+static bool
+rwlock_write_ready (const struct rwlock *rw) {
+	return rw->writer == NULL && rw->reader_cnt == 0;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or
+   waits for it if necessary, and records the hold in H, which
+   must stay valid until RW is released.  RW must not already be
+   held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw, struct rwlock_hold *h) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (h != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_for_read (rw) && !rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	if (rwlock_read_ready (rw))
+		rwlock_take_read (rw, h, thread_current ());
+	else
+		rwlock_wait (rw, &rw->readers_q, &h->waiter);
+	intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for reading without sleeping, recording
+   the hold in H, and returns true if successful. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw, struct rwlock_hold *h) {
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (rw != NULL);
+	ASSERT (h != NULL);
+	ASSERT (!rwlock_held_for_read (rw) && !rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	success = rwlock_read_ready (rw);
+	if (success)
+		rwlock_take_read (rw, h, thread_current ());
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_read (rw));
+
+	old_level = intr_disable ();
+	rwlock_drop_read (rw, thread_current ());
+	rwlock_settle (rw);
+	intr_set_level (old_level);
+	thread_preempt ();
+}
+
+/* Acquires RW for writing, sleeping until it is free if
+   necessary.  RW must not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!rwlock_held_for_read (rw) && !rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	if (rwlock_write_ready (rw))
+		rwlock_take_write (rw, thread_current ());
+	else {
+		struct waitq_elem waiter;
+		rwlock_wait (rw, &rw->writers_q, &waiter);
+	}
+	intr_set_level (old_level);
+}
+
+/* Tries to acquire RW for writing without sleeping, and returns
+   true if successful. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (rw != NULL);
+	ASSERT (!rwlock_held_for_read (rw) && !rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	success = rwlock_write_ready (rw);
+	if (success)
+		rwlock_take_write (rw, thread_current ());
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	rwlock_drop_write (rw);
+	rwlock_settle (rw);
+	intr_set_level (old_level);
+	thread_preempt ();
+}
+
+/* Turns the current thread's read hold on RW into a write hold,
+   sleeping until the other readers are gone.  Returns false,
+   still holding RW for reading, if another reader is already
+   upgrading: both waiting would deadlock, so the caller should
+   release RW and acquire it for writing instead.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+rwlock_upgrade (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	bool success = true;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rwlock_held_for_read (rw));
+
+	old_level = intr_disable ();
+	if (rw->upgrader != NULL)
+		success = false;
+	else if (rw->reader_cnt == 1) {
+		rwlock_drop_read (rw, curr);
+		rwlock_take_write (rw, curr);
+		rwlock_settle (rw);
+	} else {
+		rw->upgrader = curr;
+		rwlock_wait (rw, NULL, NULL);
+	}
+	intr_set_level (old_level);
+	return success;
+}
+
+/* Turns the current thread's write hold on RW into a read hold,
+   recorded in H, without letting any writer in between.  Waiting
+   readers are let in with it, unless a writer waits. */
+void
+rwlock_downgrade (struct rwlock *rw, struct rwlock_hold *h) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (h != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	old_level = intr_disable ();
+	rwlock_drop_write (rw);
+	rwlock_take_read (rw, h, curr);
+	rwlock_settle (rw);
+	intr_set_level (old_level);
+	thread_preempt ();
+}
+
+/* Returns true if the current thread holds RW for reading. */
+bool
+rwlock_held_for_read (const struct rwlock *rw) {
+	enum intr_level old_level;
+	bool held;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	held = rwlock_find_hold (rw, thread_current ()) != NULL;
+	intr_set_level (old_level);
+	return held;
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
+
+/* Returns the running thread, as recorded in spinlock holders.
+   Unlike thread_current(), works inside the scheduler, where the
+   running thread's status is no longer THREAD_RUNNING. */
+static struct thread *
+spinlock_owner (void) {
+	return pg_round_down (rrsp ());
+}
+
+/* Initializes spinlock LOCK, which starts out released, as a
+   member of lock class CLASS.
+
+   Use the spinlock_init() macro rather than calling this
+   directly; it supplies a CLASS for each call site. */
+void
+spinlock_init_class (struct spinlock *lock, struct lock_class *class) {
+	ASSERT (lock != NULL);
+	ASSERT (class != NULL);
+
+	lock->locked = 0;
+	lock->holder = NULL;
+	lock->class = class;
+	lock->acquire_tsc = 0;
+	if (!class->registered)
+		lock_class_register (class);
+}
+
+/* Tries once to take LOCK, without profiling.  Returns true if
+   successful. */
+static bool
+spinlock_take (struct spinlock *lock) {
+	int busy = 1;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* xchg with a memory operand is implicitly locked, and is a
+	   full barrier, so nothing inside the critical section is
+	   reordered before it. */
+	asm volatile ("xchgl %0, %1" : "+r" (busy), "+m" (lock->locked)
+			: : "memory");
+	if (busy)
+		return false;
+	lock->holder = spinlock_owner ();
+	return true;
+}
+
+/* Tries to acquire LOCK without spinning.  Returns true if
+   successful, false if another CPU holds it.  Interrupts must be
+   off. */
+bool
+spinlock_try_acquire (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	if (!spinlock_take (lock))
+		return false;
+	if (lock_profiling)
+		lock_profile_acquire (lock->class, &lock->acquire_tsc, lock->holder,
+				false, 0);
+	return true;
+}
+
+/* Acquires LOCK, spinning until it becomes available.  The lock
+   must not already be held by the current thread, and interrupts
+   must be off. */
+void
+spinlock_acquire (struct spinlock *lock) {
+	uint64_t start = 0;
+	bool contended = false;
+
+	ASSERT (lock != NULL);
+	ASSERT (!spinlock_held_by_current_thread (lock));
+
+	while (!spinlock_take (lock)) {
+		if (!contended && lock_profiling)
+			start = rdtsc ();
+		contended = true;
+		/* Spin on a plain read so the cache line stays shared
+		   until the holder releases it. */
+		while (lock->locked)
+			asm volatile ("pause");
+	}
+	if (lock_profiling)
+		lock_profile_acquire (lock->class, &lock->acquire_tsc, lock->holder,
+				contended, contended ? rdtsc () - start : 0);
+}
+
+/* Releases LOCK, which must be held by the current thread. */
+void
+spinlock_release (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (spinlock_held_by_current_thread (lock));
+
+	if (lock_profiling)
+		lock_profile_release (lock->class, &lock->acquire_tsc);
+	lock->holder = NULL;
+	barrier ();
+	lock->locked = 0;
+}
+
+/* Returns true if the current thread holds LOCK, false
+   otherwise. */
+bool
+spinlock_held_by_current_thread (const struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	return lock->locked && lock->holder == spinlock_owner ();
+}
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's wait queue. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct waitq_elem elem;             /* Wait queue element. */
 	struct semaphore semaphore;         /* This semaphore. */
 };
 
@@ -304,7 +1145,9 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	waitq_init (&cond->waiters);
+	cond->waits = 0;
+	cond->wait_cycles = 0;
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -335,19 +1178,10 @@ cond_init (struct condition *cond) {
    We only have to consider Conditions in here.
    */
 
-bool sem_less_priority(const struct list_elem* a, const struct list_elem* b, void *aux UNUSED){
-	struct semaphore* a_sem= &list_entry(a, struct semaphore_elem, elem)->semaphore;
-	struct semaphore* b_sem= &list_entry(b, struct semaphore_elem, elem)->semaphore;
-	if (list_empty(&a_sem->waiters)) return false;
-	if (list_empty(&b_sem->waiters)) return true;
-	struct thread* a_thread= list_entry(list_front(&a_sem->waiters), struct thread, elem);
-	struct thread* b_thread= list_entry(list_front(&b_sem->waiters), struct thread, elem);
-	return (a_thread->priority>b_thread->priority);
-}
-
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -355,8 +1189,9 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered(&cond->waiters, &waiter.elem, sem_less_priority, 0);
+	old_level = intr_disable ();
+	waitq_push (&cond->waiters, &waiter.elem, thread_current ());
+	intr_set_level (old_level);
 	lock_release (lock); //sema_up(lock->semaphore)
 	 
 	/*
@@ -364,9 +1199,12 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	Lock is released only to change waiter's semaphore.
 	Lock doesn't need to be considered in here.
 	*/
+	uint64_t start = rdtsc ();
 	sema_down (&waiter.semaphore);
 	//Condition is now signaled.
 	lock_acquire (lock);
+	cond->waits++;
+	cond->wait_cycles += rdtsc () - start;
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
@@ -378,17 +1216,19 @@ cond_wait (struct condition *cond, struct lock *lock) {
    interrupt handler. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	struct waitq_elem *e;
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-
-	    list_sort(&cond->waiters, sem_less_priority, 0);
-
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	e = waitq_pop (&cond->waiters);
+	intr_set_level (old_level);
+	if (e != NULL)
+		sema_up (&waitq_entry (e, struct semaphore_elem, elem)->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -402,6 +1242,6 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!waitq_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -9,7 +10,11 @@
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 //#include "threads/synch.h"
+#include "threads/switch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
+#include <heap.h>
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,21 +29,40 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queues of processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running.  There is one FIFO
+   queue per priority, and bit P of ready_bitmap is set iff
+   ready_queues[P] is non-empty, so the highest ready priority is
+   found with a single bit scan. */
+#if PRI_MAX >= 64
+#error ready_bitmap holds at most 64 priorities
+#endif
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of ready threads, in any run queue. */
 
-/* List of processes in THREAD_BLOCKED state, that is, processes
-   that are not actually running during the "duration". */
-static struct list sleep_list;
+/* Stride scheduling (-stride) keeps ready threads in a min-heap
+   on pass instead of ready_queues. */
+static struct heap stride_heap;
+static int64_t stride_pass;     /* Pass of the latest thread dispatched. */
 
-/* List of processes in THREAD_BLOCKED state, that is, processes
-   that are not actually running during the "duration". */
-static struct list total_list;
+/* Real-time threads ready to run, earliest deadline first.
+   Always served before the other run queues. */
+static struct heap rt_heap;
 
 /* Idle thread. */
 static struct thread *idle_thread;
 
+/* True if T is the idle thread. */
+#define is_idle_thread(t) ((t) == idle_thread)
+
+/* Hash table of every live thread except the idle thread, keyed
+   by tid, for get_thread().  Tids are handed out sequentially, so
+   the low bits spread threads evenly over the buckets. */
+#define TID_BUCKETS 256
+static struct list tid_table[TID_BUCKETS];
+#define tid_bucket(TID) (&tid_table[(unsigned) (TID) % TID_BUCKETS])
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
@@ -48,11 +72,32 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Pages of dead threads kept for reuse by thread_create(), most
+   recently freed first, linked through their `elem'.  A reused
+   page needs only its struct thread reset, by init_thread(), so
+   creating a thread from the cache skips the page allocator and
+   zeroing the whole page. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+static uint64_t thread_cache_hits;   /* # of pages taken from the cache. */
+static uint64_t thread_cache_misses; /* # of pages taken from palloc. */
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
 static long long user_ticks;    /* # of timer ticks in user programs. */
 
+/* Scheduler statistics of all threads, live or dead, in TSC
+   cycles.  The per-thread counterparts are in struct thread. */
+static uint64_t wakeups;        /* # of blocked threads readied. */
+static uint64_t wakeup_cycles;  /* Total time from readied to running. */
+static uint64_t wakeup_max_cycles; /* Longest time from readied to running. */
+static uint64_t blocked_cycles; /* Total time threads spent blocked. */
+static uint64_t vol_switches;   /* # of switches away from a thread that blocked, exited or yielded. */
+static uint64_t invol_switches; /* # of switches away from a preempted thread. */
+static uint64_t runq_hist[SCHEDSTAT_RUNQ_BUCKETS]; /* Ticks by run queue length. */
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -63,6 +108,40 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 bool thread_mlfqs;
 int load_avg;
 
+/* If true, use stride scheduling: every thread holds tickets in
+   proportion to its priority and receives that share of the CPU.
+   The thread with the least pass runs next, and its pass advances
+   by STRIDE1 / tickets for every tick it runs.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+#define STRIDE1 (1 << 20)
+
+/* Switch threads through switch_threads() rather than do_iret(). */
+bool thread_fast_switch = true;
+#define thread_tickets(t) ((t)->priority - PRI_MIN + 1)
+
+/* Real-time threads admitted so far may claim this share of the
+   CPU, in units of 1/RT_UTIL_ONE.  Never exceeds RT_UTIL_ONE. */
+#define RT_UTIL_ONE (1 << 20)
+static int64_t rt_utilization;
+static int64_t rt_misses;       /* # of jobs not finished by the next release. */
+
+/* Timing parameters of a real-time thread, in timer ticks. */
+struct rt_params {
+	int64_t period;                 /* Time between releases. */
+	int64_t budget;                 /* CPU time allowed per period. */
+	int64_t deadline;               /* Completion time after release. */
+};
+
+/* MLFQS recent_cpu decay is applied lazily.  Every second starts a
+   new epoch and mlfqs_coeff[] remembers the decay coefficient of
+   the latest MLFQS_HISTORY epochs.  Runnable threads are brought up
+   to date each second; a blocked thread catches up on the epochs
+   it slept through when it becomes ready again. */
+#define MLFQS_HISTORY 64
+static int64_t mlfqs_epoch;
+static int mlfqs_coeff[MLFQS_HISTORY];
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -71,6 +150,26 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void ready_push_back (struct thread *);
+static void ready_push_front (struct thread *);
+static void ready_remove (struct thread *);
+static struct thread *ready_pop (void);
+static int ready_max_priority (void);
+static bool stride_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static bool rt_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static bool thread_outranks (const struct thread *, const struct thread *);
+static tid_t do_thread_create (const char *name, int priority,
+		thread_func *, void *aux, const struct rt_params *);
+static int64_t rt_util (int64_t budget, int64_t period);
+static void rt_replenish (void *t_);
+static void mlfqs_refresh (struct thread *);
+static void dis_intr_tid_insert (struct thread *);
+static void thread_woken (struct thread *);
+static void do_yield (bool preempted);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -98,11 +197,6 @@ bool less_priority(const struct list_elem *a, const struct list_elem *b, void *a
 	struct thread* b_thread= list_entry(b, struct thread, elem);
 	return (a_thread->priority>b_thread->priority);
 }
-bool less_donated_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) { 
-	struct thread* a_thread= list_entry(a, struct thread, donated_elem);
-	struct thread* b_thread= list_entry(b, struct thread, donated_elem);
-	return (a_thread->priority>b_thread->priority);
-}
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -133,10 +227,17 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&sleep_list);
-	list_init (&total_list);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&ready_queues[i]);
+	ready_bitmap = 0;
+	ready_cnt = 0;
+	heap_init (&stride_heap, stride_less, NULL);
+	stride_pass = 0;
+	heap_init (&rt_heap, rt_less, NULL);
+	for (int i = 0; i < TID_BUCKETS; i++)
+		list_init (&tid_table[i]);
 	list_init (&destruction_req);
+	list_init (&thread_cache);
 
 
 	/* Set up a thread structure for the running thread. */
@@ -144,11 +245,11 @@ thread_init (void) {
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
-	list_push_back(&total_list,&initial_thread->total_list_elem);//main에도 이게 필요함?
+	list_push_back(tid_bucket (initial_thread->tid),&initial_thread->tid_elem);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
-   Also creates the idle thread. */
+   Also creates the idle thread and the workqueue workers. */
 void
 thread_start (void) {
 	/* Create the idle thread. */
@@ -161,23 +262,45 @@ thread_start (void) {
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down (&idle_started);
+
+	/* Start the deferred-work pool. */
+	workqueue_start ();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+   Thus, this function runs in an external interrupt context.
+   USER is true if the tick interrupted user mode. */
 void
-thread_tick (void) {
+thread_tick (bool user) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
-	if (t == idle_thread)
+	if (is_idle_thread (t))
 		idle_ticks++;
-#ifdef USERPROG
-	else if (t->pml4 != NULL)
+	else if (user) {
 		user_ticks++;
-#endif
-	else
+		t->ru.user_ticks++;
+	} else {
 		kernel_ticks++;
+		t->ru.sys_ticks++;
+	}
+
+	size_t n = ready_cnt;
+	int bucket = 0;
+	while (n > 0 && bucket < SCHEDSTAT_RUNQ_BUCKETS - 1) {
+		n >>= 1;
+		bucket++;
+	}
+	runq_hist[bucket]++;
+
+	if (thread_stride && !is_idle_thread (t))
+		t->pass += STRIDE1 / thread_tickets (t);
+
+	/* Enforce real-time budget. */
+	if (t->rt && --t->rt_remaining <= 0) {
+		t->rt_throttled = true;
+		intr_yield_on_return ();
+	}
 
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
@@ -189,8 +312,136 @@ void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread: %"PRIu64" wakeups, %"PRIu64" cycles avg / %"PRIu64" max "
+			"wakeup latency, %"PRIu64" cycles blocked\n", wakeups,
+			wakeups ? wakeup_cycles / wakeups : 0, wakeup_max_cycles,
+			blocked_cycles);
+	printf ("Thread: %"PRIu64" voluntary, %"PRIu64" involuntary switches\n",
+			vol_switches, invol_switches);
+	if (rt_misses > 0)
+		printf ("Thread: %"PRId64" real-time deadline misses\n", rt_misses);
+	printf ("Thread: %"PRIu64" of %"PRIu64" thread pages reused\n",
+			thread_cache_hits, thread_cache_hits + thread_cache_misses);
+	printf ("Thread: run queue length histogram (ticks):");
+	for (int i = 0; i < SCHEDSTAT_RUNQ_BUCKETS; i++)
+		printf (" %"PRIu64, runq_hist[i]);
+	printf ("\n");
+}
+
+/* Fills STAT with the running thread's scheduler statistics, the
+   system-wide run queue length histogram and the thread page cache
+   counters. */
+void
+thread_get_sched_stat (struct sched_stat *stat) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	stat->wakeups = curr->wakeups;
+	stat->wakeup_cycles = curr->wakeup_cycles;
+	stat->wakeup_max_cycles = curr->wakeup_max_cycles;
+	stat->blocked_cycles = curr->blocked_cycles;
+	stat->vol_switches = curr->vol_switches;
+	stat->invol_switches = curr->invol_switches;
+	memcpy (stat->runq_hist, runq_hist, sizeof runq_hist);
+	stat->thread_cache_hits = thread_cache_hits;
+	stat->thread_cache_misses = thread_cache_misses;
+	intr_set_level (old_level);
+}
+
+/* Adds the counts in ADD to those in SUM. */
+static void
+rusage_add (struct rusage *sum, const struct rusage *add) {
+	sum->user_ticks += add->user_ticks;
+	sum->sys_ticks += add->sys_ticks;
+	sum->vol_switches += add->vol_switches;
+	sum->invol_switches += add->invol_switches;
+	sum->lazy_faults += add->lazy_faults;
+	sum->swap_faults += add->swap_faults;
+	sum->stack_faults += add->stack_faults;
+	sum->read_bytes += add->read_bytes;
+	sum->write_bytes += add->write_bytes;
 }
 
+/* Adds the resource usage of thread T alone to RU. */
+static void
+thread_own_rusage (const struct thread *t, struct rusage *ru) {
+	rusage_add (ru, &t->ru);
+	ru->vol_switches += t->vol_switches;
+	ru->invol_switches += t->invol_switches;
+}
+
+/* Fills RU with the resource usage of T if WHO is RUSAGE_SELF,
+   or with that of the children T has waited for if WHO is
+   RUSAGE_CHILDREN.  For a user process, T is its leader, and its
+   usage is that of all its threads, exited or not. */
+void
+thread_get_rusage (struct thread *t, int who, struct rusage *ru) {
+	enum intr_level old_level = intr_disable ();
+
+	if (who == RUSAGE_CHILDREN)
+		*ru = t->children_ru;
+	else {
+		memset (ru, 0, sizeof *ru);
+		thread_own_rusage (t, ru);
+#ifdef USERPROG
+		if (t->leader == t && t->process != NULL) {
+			struct list *threads = &t->process->threads;
+			struct list_elem *e;
+
+			rusage_add (ru, &t->process->threads_ru);
+			for (e = list_begin (threads); e != list_end (threads);
+					e = list_next (e))
+				thread_own_rusage (list_entry (e, struct thread, thread_elem), ru);
+		}
+#endif
+	}
+	intr_set_level (old_level);
+}
+
+/* Adds the resource usage of CHILD, which has exited, and of its
+   own reaped children to the children's usage of the running
+   thread's process.  Called when the running thread waits for
+   CHILD. */
+void
+thread_reap_rusage (struct thread *child) {
+	struct thread *curr = thread_current ();
+	struct rusage self;
+
+#ifdef USERPROG
+	curr = curr->leader;
+#endif
+	thread_get_rusage (child, RUSAGE_SELF, &self);
+	rusage_add (&curr->children_ru, &self);
+	rusage_add (&curr->children_ru, &child->children_ru);
+}
+
+#ifdef USERPROG
+/* Keeps the running thread's process charged for its threads as
+   they exit.  A thread other than the leader hands its own usage
+   over to the process.  The leader, exiting last, takes over the
+   usage of all the others before the process is freed. */
+void
+thread_merge_rusage (void) {
+	struct thread *curr = thread_current ();
+	struct process *p = curr->process;
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (p != NULL);
+
+	if (curr->leader != curr) {
+		thread_own_rusage (curr, &p->threads_ru);
+		memset (&curr->ru, 0, sizeof curr->ru);
+		curr->vol_switches = 0;
+		curr->invol_switches = 0;
+	} else {
+		ASSERT (list_empty (&p->threads));
+		rusage_add (&curr->ru, &p->threads_ru);
+		memset (&p->threads_ru, 0, sizeof p->threads_ru);
+	}
+	intr_set_level (old_level);
+}
+#endif
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -209,14 +460,87 @@ thread_print_stats (void) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	return do_thread_create (name, priority, function, aux, NULL);
+}
+
+/* Creates a real-time thread named NAME, which executes FUNCTION
+   passing AUX as the argument, and adds it to the ready queue.
+
+   The thread is released every PERIOD timer ticks, starting now.
+   In each period it may run for at most BUDGET ticks, and the
+   job it does should complete within DEADLINE ticks of the
+   release; it calls thread_wait_next_period() when done.  Ready
+   real-time threads run before all other threads, earliest
+   deadline first.  A thread that exhausts its budget does not run
+   again until its next release.
+
+   Returns TID_ERROR if the parameters are inconsistent, that is,
+   unless 0 < BUDGET <= DEADLINE <= PERIOD, or if admitting the
+   thread would raise the combined BUDGET / PERIOD of all
+   real-time threads above 1, so that EDF could no longer
+   guarantee every deadline. */
+tid_t
+thread_create_rt (const char *name, int64_t period, int64_t budget,
+		int64_t deadline, thread_func *function, void *aux) {
+	struct rt_params rt = { period, budget, deadline };
+	enum intr_level old_level;
+	int64_t util;
+	tid_t tid;
+
+	if (budget <= 0 || budget > deadline || deadline > period)
+		return TID_ERROR;
+
+	/* Admission control. */
+	util = rt_util (budget, period);
+	old_level = intr_disable ();
+	if (rt_utilization + util > RT_UTIL_ONE) {
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+	rt_utilization += util;
+	intr_set_level (old_level);
+
+	tid = do_thread_create (name, PRI_MAX, function, aux, &rt);
+	if (tid == TID_ERROR) {
+		old_level = intr_disable ();
+		rt_utilization -= util;
+		intr_set_level (old_level);
+	}
+	return tid;
+}
+
+/* Blocks the running real-time thread until its next release,
+   marking its current job complete. */
+void
+thread_wait_next_period (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (curr->rt);
+
+	old_level = intr_disable ();
+	curr->rt_job_done = true;
+	curr->rt_waiting = true;
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Does the work of thread_create() and thread_create_rt().  RT is
+   null for an ordinary thread, otherwise the period, budget and
+   deadline of a real-time thread that has passed admission. */
+static tid_t
+do_thread_create (const char *name, int priority,
+		thread_func *function, void *aux, const struct rt_params *rt) {
 	struct thread *t;
+	struct switch_frame *sf;
 	struct file ** fd_table_page;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -224,8 +548,9 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	//t->priority_origin=priority; init_thread에 넣음
 	tid = t->tid = allocate_tid ();
+	trace_name (tid, name);
 
-	if (name != "idle")	list_push_back(&total_list,&t->total_list_elem);
+	if (name != "idle")	dis_intr_tid_insert (t);
 
 	#ifdef USERPROG
 	sema_init(&t->exit_sema, 0);
@@ -240,16 +565,29 @@ thread_create (const char *name, int priority,
 	#endif
 
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* Call the kernel_thread if it scheduled.  The first switch to
+	 * the thread pops this frame and returns into switch_entry(),
+	 * which calls kernel_thread (FUNCTION, AUX). */
+	sf = (struct switch_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	memset (sf, 0, sizeof *sf);
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
+	t->switch_rsp = (uint64_t) sf;
+
+	if (rt != NULL) {
+		int64_t now = timer_ticks ();
+
+		t->rt = true;
+		t->rt_period = rt->period;
+		t->rt_budget = rt->budget;
+		t->rt_rel_deadline = rt->deadline;
+		t->rt_deadline = now + t->rt_rel_deadline;
+		t->rt_remaining = t->rt_budget;
+		timer_event_init (&t->rt_release, rt_replenish, t);
+		timer_event_add (&t->rt_release, now + t->rt_period);
+	}
 
 	/* Add to run queue. */
 	//thread_unblock (t);
@@ -287,8 +625,8 @@ thread_unblock (struct thread *t) {
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
 
-	//list_push_back (&ready_list, &t->elem);
-	list_insert_ordered(&ready_list,&t->elem,less_priority,0);
+	thread_woken (t);
+	ready_push_back (t);
 	t->status = THREAD_READY;
 	
 	
@@ -320,23 +658,26 @@ THREAD_BLOCKED should be ASSERTED outside of treason.
 
 void
 thread_treason (struct thread *t) {
+	thread_woken (t);
 	//If current thread's priority is bigger than t. Treason failed.  
-    if(thread_get_priority()>=t->priority){
-		list_insert_ordered(&ready_list,&t->elem,less_priority,0);
+    if(!thread_outranks (t, thread_current ())){
+		ready_push_back (t);
 		t->status = THREAD_READY;
 	}
 	else{ //Treason succeeded.
 		if(!intr_context()){
        	struct thread *curr = thread_current ();
-		if (curr != idle_thread){
-			list_insert_ordered(&ready_list,&curr->elem,less_priority,0);
+		if (!is_idle_thread (curr)){
+			ready_push_back (curr);
 		}
-		list_push_front(&ready_list,&t->elem);
+		curr->preempted = true;
+		ready_push_front (t);
+		t->status = THREAD_READY;
 		do_schedule (THREAD_READY);
 		}
 		else{
-			struct thread *curr = thread_current ();
-			list_push_front(&ready_list,&t->elem);
+			ready_push_front (t);
+			t->status = THREAD_READY;
 			intr_yield_on_return();
 		}
 	}
@@ -365,14 +706,31 @@ thread_current (void) {
 
 	return t;
 }
-/* Get thread corresponding to tid */
+/* Get thread corresponding to tid, or NULL if it has exited.
+   Only scans the threads that share TID's hash bucket. */
 struct thread*
 get_thread(tid_t tid){
-	for (struct list_elem* c = list_front(&total_list); c != list_end(&total_list); c = c->next){
-		struct thread* t = list_entry(c,struct thread, total_list_elem);
-		if (t->tid == tid) return t;
+	struct list *bucket = tid_bucket (tid);
+	struct thread *found = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	for (struct list_elem* c = list_begin(bucket); c != list_end(bucket); c = list_next(c)){
+		struct thread* t = list_entry(c,struct thread, tid_elem);
+		if (t->tid == tid) {
+			found = t;
+			break;
+		}
 	}
-	return NULL;
+	intr_set_level (old_level);
+	return found;
+}
+
+/* Makes T visible to get_thread(). */
+static void
+dis_intr_tid_insert (struct thread *t) {
+	enum intr_level old_level = intr_disable ();
+	list_push_back (tid_bucket (t->tid), &t->tid_elem);
+	intr_set_level (old_level);
 }
 
 /* Returns the running thread's tid. */
@@ -394,6 +752,12 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	if (thread_current ()->rt) {
+		struct thread *curr = thread_current ();
+
+		timer_event_cancel (&curr->rt_release);
+		rt_utilization -= rt_util (curr->rt_budget, curr->rt_period);
+	}
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -402,47 +766,47 @@ thread_exit (void) {
    may be scheduled again immediately at the scheduler's whim. */
 void
 thread_yield (void) {
+	do_yield (false);
+}
+
+/* Yields the CPU on behalf of the scheduler, because the time
+   slice expired or a higher priority thread became ready.  Counts
+   as an involuntary context switch. */
+void
+thread_yield_preempted (void) {
+	do_yield (true);
+}
+
+static void
+do_yield (bool preempted) {
 	struct thread *curr = thread_current ();
 	enum intr_level old_level;
 
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		//list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered(&ready_list,&curr->elem,less_priority,0);
+	if (!is_idle_thread (curr))
+		ready_push_back (curr);
+	curr->preempted = preempted;
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
 
-/*   */
+/* Timer event function that readies the sleeping thread T_.
+   Runs in the timer softirq, so a higher priority sleeper
+   preempts on return instead of immediately. */
 void
-thread_wakeup (int64_t global_ticks) {
-	struct thread *curr = thread_current ();
-	//list_sort(&sleep_list,less_ticks,0);
-	if (!list_empty (&sleep_list))
-	{
-		struct thread* t= list_entry(list_front (&sleep_list), struct thread, elem);
-	    while (t->local_ticks <= global_ticks )
-        {
-          t->status=THREAD_READY;
-		  list_pop_front(&sleep_list);
-		  //thread_treason (t);
-			list_insert_ordered(&ready_list,&t->elem,less_priority,0);
-		   
-			if(curr->priority>=t->priority){
-				t->status = THREAD_READY;
-			}
-			else{
-				intr_yield_on_return();
-			}
-		  if (!list_empty (&sleep_list)){
-            t= list_entry(list_front (&sleep_list), struct thread, elem);
-		  }
-		  else
-		  	break;
-        }
-	}
+thread_wakeup (void *t_) {
+	struct thread *t = t_;
+
+	ASSERT (is_thread (t));
+	ASSERT (t->status == THREAD_BLOCKED);
+
+	thread_woken (t);
+	ready_push_back (t);
+	t->status = THREAD_READY;
+	if (thread_outranks (t, thread_current ()))
+		intr_yield_on_return ();
 }
 
 
@@ -453,10 +817,9 @@ thread_sleep (int64_t local_ticks) {
     
 	ASSERT (!intr_context ());
 	old_level = intr_disable ();
-	if (curr != idle_thread) {
+	if (!is_idle_thread (curr)) {
 		curr->local_ticks = local_ticks;
-		//list_push_back (&sleep_list, &curr->elem); //must_insert
-		list_insert_ordered(&sleep_list,&curr->elem,less_ticks,0);
+		timer_event_add (&curr->sleep_event, local_ticks);
 	}
 	do_schedule (THREAD_BLOCKED);
 
@@ -468,14 +831,14 @@ thread_sleep (int64_t local_ticks) {
 void
 thread_set_priority (int new_priority) {
 	if(!thread_mlfqs){
-		if(thread_current ()->priority == thread_current ()->priority_origin ){
-		thread_current ()->priority = new_priority;
-		}
-		thread_current ()->priority_origin = new_priority;
-		if(!list_empty(&ready_list)){
-			struct thread* t = list_entry(list_pop_front(&ready_list), struct thread, elem);
-			dis_intr_treason(t);
-		}
+		struct thread *curr = thread_current ();
+		enum intr_level old_level = intr_disable ();
+
+		curr->priority_origin = new_priority;
+		curr->priority = lock_effective_priority (curr);
+		thread_requeue (curr);
+		intr_set_level (old_level);
+		thread_preempt ();
 	}
 }
 
@@ -495,12 +858,7 @@ thread_set_nice (int nice){
 
 	thread_current()->nice=nice;
 	mlfqs_update_priority(thread_current()); //재계산 필요
-
-	list_sort(&ready_list,less_priority,0);
-	if(!list_empty(&ready_list)){
-		struct thread* t = list_entry(list_pop_front(&ready_list), struct thread, elem);
-		dis_intr_treason(t);
-	}
+	thread_preempt ();
 
 	intr_set_level (old_level);
 }
@@ -563,6 +921,16 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* With nothing else to run, zero free pages ahead of
+		   PAL_ZERO requests.  A thread that wakes up meanwhile
+		   preempts us as usual. */
+		intr_enable ();
+		while (palloc_zero_idle ())
+			continue;
+		intr_disable ();
+
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -607,10 +975,14 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->priority_origin = priority;
 	}
 	t->local_ticks = 0;
-	list_init(&t->donated_thread_list);
+	timer_event_init (&t->sleep_event, thread_wakeup, t);
+	heap_init (&t->held_locks, donation_less, NULL);
+	list_init (&t->waitq_elems);
 	t->nice = 0;
 	t->recent_cpu = 0;
+	t->recent_cpu_epoch = mlfqs_epoch;
     t->pressing_lock = NULL;
+	t->pressing_rwlock = NULL;
 	t->magic = THREAD_MAGIC;
 
 #ifdef USERPROG
@@ -626,6 +998,12 @@ init_thread (struct thread *t, const char *name, int priority) {
 	// t->fd_table = {0, }; // Memory allocation?
 	t->num_of_fd = 2;
 
+	t->leader = t;
+	t->process = NULL;
+	t->stack_slot = -1;
+	t->joined = false;
+	t->thread_exited = false;
+
 #endif
 
 #ifdef VM
@@ -642,10 +1020,243 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
+	struct thread *t = ready_pop ();
+
+	return t != NULL ? t : idle_thread;
+}
+
+/* Adds T to the run queue of T's current priority, at the
+   tail if BACK, else at the head. */
+static void
+ready_insert (struct thread *t, bool back) {
+	int p = t->priority;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= p && p <= PRI_MAX);
+	/* A real-time thread out of budget is parked, still
+	   THREAD_READY, until rt_replenish() releases it again. */
+	if (t->rt && t->rt_throttled)
+		return;
+
+	t->ready_priority = p;
+	if (t->rt)
+		heap_insert (&rt_heap, &t->rt_elem);
+	else if (thread_stride) {
+		/* A thread that was blocked must not be credited for the
+		   time it did not compete. */
+		if (t->pass < stride_pass)
+			t->pass = stride_pass;
+		heap_insert (&stride_heap, &t->stride_elem);
+	} else if (back)
+		list_push_back (&ready_queues[p], &t->elem);
+	else
+		list_push_front (&ready_queues[p], &t->elem);
+	if (!t->rt && !thread_stride)
+		ready_bitmap |= (uint64_t) 1 << p;
+	ready_cnt++;
+}
+
+/* Appends T to the run queue of its current priority. */
+static void
+ready_push_back (struct thread *t) {
+	ready_insert (t, true);
+}
+
+/* Puts T at the head of the run queue of its current priority, so
+   it runs before the other threads of the same priority. */
+static void
+ready_push_front (struct thread *t) {
+	ready_insert (t, false);
+}
+
+/* Removes ready thread T from the run queue it was inserted in. */
+static void
+ready_remove (struct thread *t) {
+	int p = t->ready_priority;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (t->rt)
+		heap_remove (&rt_heap, &t->rt_elem);
+	else if (thread_stride)
+		heap_remove (&stride_heap, &t->stride_elem);
+	else {
+		list_remove (&t->elem);
+		if (list_empty (&ready_queues[p]))
+			ready_bitmap &= ~((uint64_t) 1 << p);
+	}
+	ready_cnt--;
+}
+
+/* Returns the highest priority among the ready threads.  At
+   least one thread must be ready. */
+static int
+ready_max_priority (void) {
+	ASSERT (ready_bitmap != 0);
+	return 63 - __builtin_clzll (ready_bitmap);
+}
+
+/* Removes and returns the first thread of the highest non-empty
+   run queue, or a null pointer if no thread is ready. */
+static struct thread *
+ready_pop (void) {
+	struct thread *t = NULL;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!heap_empty (&rt_heap))
+		t = heap_entry (heap_min (&rt_heap), struct thread, rt_elem);
+	else if (thread_stride) {
+		if (!heap_empty (&stride_heap)) {
+			t = heap_entry (heap_min (&stride_heap), struct thread, stride_elem);
+			if (t->pass > stride_pass)
+				stride_pass = t->pass;
+		}
+	} else if (ready_bitmap != 0)
+		t = list_entry (list_front (&ready_queues[ready_max_priority ()]),
+				struct thread, elem);
+	if (t != NULL)
+		ready_remove (t);
+	return t;
+}
+
+/* Orders threads in a stride heap by pass, then by tid so that
+   threads with equal pass take turns in creation order. */
+static bool
+stride_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, stride_elem);
+	const struct thread *b = heap_entry (b_, struct thread, stride_elem);
+
+	if (a->pass != b->pass)
+		return a->pass < b->pass;
+	return a->tid < b->tid;
+}
+
+/* Orders real-time threads by absolute deadline, then by tid. */
+static bool
+rt_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, rt_elem);
+	const struct thread *b = heap_entry (b_, struct thread, rt_elem);
+
+	if (a->rt_deadline != b->rt_deadline)
+		return a->rt_deadline < b->rt_deadline;
+	return a->tid < b->tid;
+}
+
+/* Returns true if A should run in preference to the running
+   thread B.  Real-time threads outrank all others and each other
+   by earlier deadline; ordinary threads outrank each other by
+   priority, except under stride scheduling, where nobody does. */
+static bool
+thread_outranks (const struct thread *a, const struct thread *b) {
+	if (is_idle_thread (b))
+		return true;
+	if (a->rt || b->rt)
+		return a->rt && (!b->rt || a->rt_deadline < b->rt_deadline);
+	return !thread_stride && a->priority > b->priority;
+}
+
+/* Returns the CPU share of a real-time thread with BUDGET ticks
+   per PERIOD, in units of 1/RT_UTIL_ONE, rounded up so admission
+   errs on the safe side. */
+static int64_t
+rt_util (int64_t budget, int64_t period) {
+	return (budget * RT_UTIL_ONE + period - 1) / period;
+}
+
+/* Timer event function that starts a new period of real-time
+   thread T_: the budget is refilled, the deadline moves, and a
+   thread waiting for its release or parked for lack of budget
+   becomes ready.  Runs in the timer softirq. */
+static void
+rt_replenish (void *t_) {
+	struct thread *t = t_;
+	int64_t release = t->rt_release.expires;
+
+	ASSERT (is_thread (t));
+	ASSERT (t->rt);
+
+	if (!t->rt_job_done)
+		rt_misses++;
+	t->rt_job_done = false;
+	t->rt_deadline = release + t->rt_rel_deadline;
+	t->rt_remaining = t->rt_budget;
+	timer_event_add (&t->rt_release, release + t->rt_period);
+
+	if (t->status == THREAD_BLOCKED && t->rt_waiting) {
+		t->rt_waiting = false;
+		thread_woken (t);
+		t->status = THREAD_READY;
+		ready_push_back (t);
+	} else if (t->status == THREAD_READY && t->rt_throttled) {
+		t->rt_throttled = false;
+		ready_push_back (t);
+	} else if (t->status == THREAD_READY) {
+		/* Re-key by the new deadline. */
+		ready_remove (t);
+		ready_push_back (t);
+	}
+	t->rt_throttled = false;
+
+	if (t->status == THREAD_READY && thread_outranks (t, thread_current ()))
+		intr_yield_on_return ();
+}
+
+/* Yields the CPU if a ready thread outranks the running thread,
+   that is, a real-time thread with an earlier deadline, or else an
+   ordinary thread with higher priority.  Stride scheduling has no
+   notion of priority; a thread runs out its time slice. */
+void
+thread_preempt (void) {
+	enum intr_level old_level = intr_disable ();
+	struct thread *curr = thread_current ();
+	bool outranked;
+
+	if (!heap_empty (&rt_heap))
+		outranked = thread_outranks (heap_entry (heap_min (&rt_heap),
+					struct thread, rt_elem), curr);
 	else
-		return list_entry(list_pop_front (&ready_list), struct thread, elem);
+		outranked = !thread_stride && !curr->rt && ready_bitmap != 0
+			&& ready_max_priority () > thread_get_priority ();
+	intr_set_level (old_level);
+
+	if (outranked)
+		thread_yield_preempted ();
+}
+
+/* Bookkeeping for blocked thread T about to become ready. */
+static void
+thread_woken (struct thread *t) {
+	TRACE (TRACE_UNBLOCK, t->tid, 0);
+	mlfqs_refresh (t);
+	if (t->block_tsc != 0) {
+		uint64_t now = rdtsc ();
+		t->blocked_cycles += now - t->block_tsc;
+		blocked_cycles += now - t->block_tsc;
+		t->block_tsc = 0;
+		t->ready_tsc = now;
+	}
+}
+
+/* Moves T to the run queue matching its priority, if T is ready,
+   and to its new place in the wait queues it is in, whatever its
+   state: a thread in cond_wait() is queued before it blocks.  Must
+   be called whenever the priority of a thread changes, e.g. by
+   donation or MLFQS recomputation. */
+void
+thread_requeue (struct thread *t) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && !t->rt
+			&& t->ready_priority != t->priority) {
+		ready_remove (t);
+		ready_push_back (t);
+	}
+	if (!list_empty (&t->waitq_elems))
+		waitq_rekey (t);
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -679,6 +1290,11 @@ do_iret (struct intr_frame *tf) {
 /* Switching the thread by activating the new thread's page
    tables, and, if the previous thread is dying, destroying it.
 
+   Normally switch_threads() saves only the callee-saved registers
+   of the running thread.  With thread_fast_switch off, its whole
+   context is saved in its intr_frame, as it originally was.  Either
+   way TH is resumed the way it was switched out.
+
    At this function's invocation, we just switched from thread
    PREV, the new thread is already running, and interrupts are
    still disabled.
@@ -688,10 +1304,29 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
+	struct thread *curr = running_thread ();
+	uint64_t tf_cur = (uint64_t) &curr->tf;
 	uint64_t tf = (uint64_t) &th->tf;
+	uint64_t next_rsp = th->switch_rsp;
+	uint64_t resume = (uint64_t) do_iret;
 	ASSERT (intr_get_level () == INTR_OFF);
 
+	/* TH was switched out by switch_threads() or is new if it has a
+	 * saved stack pointer, otherwise it was switched out through its
+	 * intr_frame below. */
+	th->switch_rsp = 0;
+	if (thread_fast_switch) {
+		if (next_rsp != 0)
+			switch_threads (&curr->switch_rsp, next_rsp);
+		else
+			switch_to_frame (&curr->switch_rsp, &th->tf);
+		return;
+	}
+	if (next_rsp != 0) {
+		resume = (uint64_t) switch_resume;
+		tf = next_rsp;
+	}
+
 	/* The main switching logic.
 	 * We first restore the whole execution context into the intr_frame
 	 * and then switching to the next thread by calling do_iret.
@@ -717,6 +1352,7 @@ thread_launch (struct thread *th) {
 			"movq %%rdi, 72(%%rax)\n"
 			"movq %%rbp, 80(%%rax)\n"
 			"movq %%rdx, 88(%%rax)\n"
+			"movq %2, %%rdx\n"         // Fetch resume function
 			"pop %%rbx\n"              // Saved rcx
 			"movq %%rbx, 96(%%rax)\n"
 			"pop %%rbx\n"              // Saved rbx
@@ -739,9 +1375,9 @@ thread_launch (struct thread *th) {
 			"mov %%rsp, 24(%%rax)\n" // rsp
 			"movw %%ss, 32(%%rax)\n"
 			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
+			"call *%%rdx\n"
 			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
+			: : "g"(tf_cur), "g" (tf), "g" (resume) : "memory"
 			);
 }
 
@@ -756,7 +1392,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -766,6 +1402,7 @@ static void
 schedule (void) {
 	struct thread *curr = running_thread ();
 	struct thread *next = next_thread_to_run ();
+	uint64_t now = rdtsc ();
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
@@ -773,6 +1410,35 @@ schedule (void) {
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
+	/* Update statistics. */
+	if (curr->status == THREAD_BLOCKED) {
+		curr->block_tsc = now;
+		TRACE (TRACE_BLOCK, 0, 0);
+	}
+	TRACE (TRACE_SCHEDULE, next->tid, curr->status);
+	if (curr != next) {
+		if (curr->status == THREAD_READY && curr->preempted) {
+			curr->invol_switches++;
+			invol_switches++;
+		} else {
+			curr->vol_switches++;
+			vol_switches++;
+		}
+	}
+	curr->preempted = false;
+	if (next->ready_tsc != 0) {
+		uint64_t latency = now - next->ready_tsc;
+		next->wakeups++;
+		next->wakeup_cycles += latency;
+		if (latency > next->wakeup_max_cycles)
+			next->wakeup_max_cycles = latency;
+		wakeups++;
+		wakeup_cycles += latency;
+		if (latency > wakeup_max_cycles)
+			wakeup_max_cycles = latency;
+		next->ready_tsc = 0;
+	}
+
 	/* Start new time slice. */
 	thread_ticks = 0;
 
@@ -792,7 +1458,7 @@ schedule (void) {
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
 			list_push_back (&destruction_req, &curr->elem);
-			list_remove(&curr->total_list_elem);
+			list_remove(&curr->tid_elem);
 
 		}
 
@@ -802,6 +1468,41 @@ schedule (void) {
 	}
 }
 
+/* Returns a page for a new thread, from the cache of dead threads'
+   pages if possible, or a null pointer if memory is exhausted.
+   Only the struct thread at the bottom of the page is initialized,
+   by init_thread(); the stack above it holds garbage. */
+static struct thread *
+thread_page_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+		thread_cache_hits++;
+	} else
+		thread_cache_misses++;
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Returns the page of dead thread T to the cache, or to the page
+   allocator if the cache is full. */
+static void
+thread_page_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX) {
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -865,20 +1566,35 @@ Get coefficient of recent_cpu first using load_avg when updating recent_cpu
 */
 void mlfqs_update_load_avg (void){
 	int num_ready = 0;
-	if (thread_current() != idle_thread) num_ready++;
-	num_ready += (int)list_size(&ready_list);
+	if (!is_idle_thread (thread_current ())) num_ready++;
+	num_ready += (int) ready_cnt;
 	num_ready = div_num(c2f(1),  c2f(60)) * num_ready;
 	load_avg = mul_num(div_num(c2f(59), c2f(60)), load_avg) + num_ready;
 	if (load_avg < 0) load_avg = 0;
 }
+/* Applies to T's recent_cpu the decay of every epoch since it was
+   last updated.  Epochs older than the history are replayed with
+   the oldest remembered coefficient; the recurrence converges, so
+   replaying them stops once recent_cpu reaches its fixed point. */
 void mlfqs_update_recent_cpu (struct thread *t){
-	if (t != idle_thread){
-		int coeffi = div_num((2*load_avg), (2*load_avg + c2f(1)));
-		t->recent_cpu = mul_num(coeffi, t->recent_cpu) + c2f(t->nice);
+	if (!is_idle_thread (t)){
+		int64_t oldest = mlfqs_epoch - MLFQS_HISTORY + 1;
+		int64_t e = t->recent_cpu_epoch;
+
+		while (e < mlfqs_epoch) {
+			e++;
+			int coeffi = mlfqs_coeff[(e < oldest ? oldest : e) % MLFQS_HISTORY];
+			int recent_cpu = mul_num(coeffi, t->recent_cpu) + c2f(t->nice);
+
+			if (e < oldest && recent_cpu == t->recent_cpu)
+				e = oldest - 1;
+			t->recent_cpu = recent_cpu;
+		}
+		t->recent_cpu_epoch = mlfqs_epoch;
 	}
 }
 void mlfqs_update_priority (struct thread *t){
-	if (t != idle_thread){
+	if (!is_idle_thread (t) && !t->rt){
 		t->priority = conv_to_int_round_zero(c2f(PRI_MAX) -t->recent_cpu/4- 2*c2f(t->nice)) ; 
 		if(t->priority>PRI_MAX){
 			t->priority=PRI_MAX;
@@ -886,29 +1602,57 @@ void mlfqs_update_priority (struct thread *t){
 		if(t->priority<PRI_MIN){
 			t->priority=PRI_MIN;
 		}
+		/* The run queues are rebuilt by the callers, but a thread
+		   may sit in a wait queue while it runs, see cond_wait(). */
+		if (!list_empty (&t->waitq_elems))
+			waitq_rekey (t);
+	}
+}
+
+/* Brings a thread that is about to become ready up to date with
+   the epochs it missed while blocked.  Nothing to do before the
+   idle thread has started, and the idle thread itself must keep
+   its priority. */
+static void
+mlfqs_refresh (struct thread *t) {
+	if (thread_mlfqs && idle_thread != NULL) {
+		mlfqs_update_recent_cpu (t);
+		mlfqs_update_priority (t);
 	}
 }
 /*해당 함수는 그냥 timer_interrupt에서 만들어도 될듯*/
 // void mlfqs_increse_recent_cpu_running (void aux UNUSED){
 
+/* Starts a new epoch and updates the runnable threads, that is,
+   the running thread and the ready ones.  Blocked threads are left
+   alone until mlfqs_refresh().  Costs O(# of ready threads). */
 void mlfqs_update_all_thread (void){
-	mlfqs_update_all_threads_on_list(&total_list);
-	//mlfqs_update_all_threads_on_list(&ready_list);
-	//mlfqs_update_all_threads_on_list(&sleep_list);
-}
-
-void mlfqs_update_all_threads_on_list (struct list* list_addr){
-	if(!list_empty(list_addr)){
-		struct thread* a_thread= list_entry(list_front(list_addr), struct thread, total_list_elem);
-		while(&a_thread->total_list_elem!=list_end(list_addr)){
-			mlfqs_update_recent_cpu(a_thread);//update recent_cpu_running
-			mlfqs_update_priority(a_thread); //update priority 
-			a_thread=list_entry(list_next(&a_thread->total_list_elem), struct thread, total_list_elem);
-		}
+	struct thread *curr = thread_current ();
+	struct list runnable;
+	struct thread *t;
+
+	mlfqs_epoch++;
+	mlfqs_coeff[mlfqs_epoch % MLFQS_HISTORY] =
+		div_num((2*load_avg), (2*load_avg + c2f(1)));
+
+	mlfqs_update_recent_cpu(curr);
+	mlfqs_update_priority(curr);
+
+	/* Empty the run queues highest priority first, so threads
+	   that land in the same queue keep their relative order. */
+	list_init (&runnable);
+	while ((t = ready_pop ()) != NULL)
+		list_push_back (&runnable, &t->elem);
+	while (!list_empty (&runnable)) {
+		t = list_entry (list_pop_front (&runnable),
+				struct thread, elem);
+		mlfqs_update_recent_cpu(t);
+		mlfqs_update_priority(t);
+		ready_push_back (t);
 	}
 }
 bool is_idle(void){
-	return thread_current() == idle_thread;
+	return is_idle_thread (thread_current ());
 }
 
 /* Defined to use things in process.c */
@@ -918,5 +1662,5 @@ void thread_sema_down (struct semaphore * sem){
 }
 
 void thread_push_ready_list(struct thread* t){
-	list_insert_ordered(&ready_list, &t->elem, less_priority, 0);
+	ready_push_back (t);
 }
@@ -0,0 +1,112 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Event tracing.
+
+   With the -trace option, tracepoints throughout the kernel
+   record events in a ring buffer of fixed size, overwriting the
+   oldest events once it is full.  Writing a record takes no
+   lock: interrupts are turned off just long enough to claim a
+   slot and fill it in, so tracepoints may be hit from interrupt
+   handlers and from inside the scheduler.
+
+   At power off the buffer is printed to the console, from which
+   utils/trace2json converts it to the Chrome trace format. */
+
+/* Pages in the trace buffer. */
+#define TRACE_PAGES 16
+
+/* A recorded event. */
+struct trace_record {
+	uint64_t tsc;               /* Time stamp counter. */
+	uint64_t arg[2];            /* Arguments. */
+	int32_t tid;                /* Thread that was running. */
+	uint16_t event;             /* A `enum trace_event'. */
+};
+
+bool trace_enabled;
+
+static struct trace_record *trace_buf;
+static size_t trace_cnt;        /* Records in buffer, a power of 2. */
+static uint64_t trace_head;     /* Records ever written. */
+
+/* Allocates the trace buffer and starts tracing. */
+void
+trace_init (void) {
+	trace_buf = palloc_get_multiple (PAL_ASSERT, TRACE_PAGES);
+	trace_cnt = TRACE_PAGES * PGSIZE / sizeof *trace_buf;
+	while (trace_cnt & (trace_cnt - 1))
+		trace_cnt &= trace_cnt - 1;
+
+	trace_enabled = true;
+	trace_name (thread_tid (), thread_name ());
+}
+
+/* Records EVENT with arguments A0 and A1, charged to the running
+   thread.  Use TRACE instead of calling this directly. */
+void
+trace_record (enum trace_event event, uint64_t a0, uint64_t a1) {
+	struct trace_record *r;
+	enum intr_level old_level;
+
+	ASSERT (event < TRACE_EVENT_CNT);
+
+	old_level = intr_disable ();
+	r = &trace_buf[trace_head++ & (trace_cnt - 1)];
+	r->tsc = rdtsc ();
+	r->arg[0] = a0;
+	r->arg[1] = a1;
+	/* The running thread's status may not be THREAD_RUNNING
+	   inside the scheduler, so don't use thread_current(). */
+	r->tid = ((struct thread *) pg_round_down (rrsp ()))->tid;
+	r->event = event;
+	intr_set_level (old_level);
+}
+
+/* Records that thread TID is named NAME, so that the trace can be
+   read without knowing tids.  The name takes two records, which
+   are written back to back. */
+void
+trace_name (int tid, const char *name) {
+	uint64_t packed[2] = { 0, 0 };
+	enum intr_level old_level;
+
+	strlcpy ((char *) packed, name, sizeof packed);
+	old_level = intr_disable ();
+	TRACE (TRACE_THREAD_NAME, tid, packed[0]);
+	TRACE (TRACE_THREAD_NAME, tid, packed[1]);
+	intr_set_level (old_level);
+}
+
+/* Prints the trace buffer, oldest record first, and stops
+   tracing.  Each record is printed as a line
+	   T tsc event tid arg0 arg1
+   with the arguments in hex. */
+void
+trace_dump (void) {
+	uint64_t first, i;
+
+	if (!trace_enabled)
+		return;
+	trace_enabled = false;
+
+	first = trace_head > trace_cnt ? trace_head - trace_cnt : 0;
+
+	printf ("Trace: %"PRIu64" records, %"PRIu64" lost, %"PRIu64" Hz.\n",
+			trace_head - first, first, timer_tsc_hz ());
+	for (i = first; i < trace_head; i++) {
+		const struct trace_record *r = &trace_buf[i & (trace_cnt - 1)];
+		printf ("T %"PRIu64" %u %"PRId32" %"PRIx64" %"PRIx64"\n",
+				r->tsc, r->event, r->tid, r->arg[0], r->arg[1]);
+	}
+	printf ("Trace: end.\n");
+}
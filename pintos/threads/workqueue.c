@@ -0,0 +1,288 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Deferred work.
+
+   Work that need not finish before a system call or page fault
+   returns, e.g. writeback or zeroing, can be handed to a
+   workqueue and run later by one of a few kernel worker threads.
+   The pool is shared by all queues.  A worker that finds no work
+   blocks; queueing work wakes one, at the queue's priority, so
+   work on a high-priority queue preempts lower-priority threads
+   as soon as it is queued.
+
+   Delayed work is filed in the timer wheel and queued from the
+   timer softirq when it expires.  Interrupts are off while
+   queues are accessed, so work may be queued from interrupt
+   handlers. */
+
+/* Number of worker threads. */
+#define WORKERS 4
+
+/* All queues, highest priority first. */
+static struct list workqueues;
+
+/* Idle workers. */
+static struct waitq idle_workers;
+
+static struct workqueue system_wq_;
+static struct workqueue system_highpri_wq_;
+struct workqueue *system_wq = &system_wq_;
+struct workqueue *system_highpri_wq = &system_highpri_wq_;
+
+static thread_func worker;
+static timer_event_func work_timer;
+static void workqueue_check_idle (struct workqueue *);
+static bool workqueue_higher (const struct list_elem *,
+		const struct list_elem *, void *aux);
+
+/* Creates the system queues and starts the worker threads.
+   Called from thread_start(). */
+void
+workqueue_start (void) {
+	char name[16];
+	int i;
+
+	list_init (&workqueues);
+	waitq_init (&idle_workers);
+	workqueue_init (system_wq, "events", PRI_DEFAULT);
+	workqueue_init (system_highpri_wq, "events_highpri", PRI_MAX);
+
+	for (i = 0; i < WORKERS; i++) {
+		snprintf (name, sizeof name, "kworker/%d", i);
+		thread_create (name, PRI_DEFAULT, worker, NULL);
+	}
+}
+
+/* Initializes WQ as an empty queue named NAME whose work runs at
+   PRIORITY, and makes it visible to the worker threads. */
+void
+workqueue_init (struct workqueue *wq, const char *name, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (wq != NULL);
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	wq->name = name;
+	wq->priority = priority;
+	list_init (&wq->works);
+	wq->running = 0;
+	waitq_init (&wq->flushers);
+
+	old_level = intr_disable ();
+	list_insert_ordered (&workqueues, &wq->elem, workqueue_higher, NULL);
+	intr_set_level (old_level);
+}
+
+/* Initializes W to call FUNC with AUX when run. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->wq = NULL;
+	w->pending = false;
+	timer_event_init (&w->timer, work_timer, w);
+}
+
+/* Appends W to its queue and hands it to an idle worker, if any.
+   The worker is given the queue's priority before it is woken. */
+static void
+work_enqueue (struct work *w) {
+	struct waitq_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	list_push_back (&w->wq->works, &w->elem);
+	e = waitq_pop (&idle_workers);
+	if (e == NULL)
+		return;
+	if (!thread_mlfqs)
+		e->thread->priority = e->thread->priority_origin = w->wq->priority;
+	if (intr_context ())
+		thread_wakeup (e->thread);
+	else
+		thread_unblock (e->thread);
+}
+
+/* Queues W on WQ, to be run by a worker thread.  Returns false,
+   without doing anything, if W is already pending.  May be called
+   from an interrupt handler. */
+bool
+queue_work (struct workqueue *wq, struct work *w) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL && w != NULL);
+
+	old_level = intr_disable ();
+	if (!w->pending) {
+		w->pending = true;
+		w->wq = wq;
+		work_enqueue (w);
+		queued = true;
+	}
+	intr_set_level (old_level);
+
+	if (queued && !intr_context ())
+		thread_preempt ();
+	return queued;
+}
+
+/* Queues W on WQ after TICKS timer ticks.  Returns false, without
+   doing anything, if W is already pending. */
+bool
+queue_delayed_work (struct workqueue *wq, struct work *w, int64_t ticks) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL && w != NULL);
+
+	if (ticks <= 0)
+		return queue_work (wq, w);
+
+	old_level = intr_disable ();
+	if (!w->pending) {
+		w->pending = true;
+		w->wq = wq;
+		timer_event_add (&w->timer, timer_ticks () + ticks);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Timer event function that queues delayed work W_. */
+static void
+work_timer (void *w_) {
+	struct work *w = w_;
+
+	ASSERT (w->pending);
+	work_enqueue (w);
+}
+
+/* Withdraws W if it is pending.  Returns true if it was, false if
+   it was not queued or has already started running.  Does not
+   wait for a running W to finish. */
+bool
+cancel_work (struct work *w) {
+	enum intr_level old_level;
+	bool canceled = false;
+
+	ASSERT (w != NULL);
+
+	old_level = intr_disable ();
+	if (w->pending) {
+		if (w->timer.pending)
+			timer_event_cancel (&w->timer);
+		else {
+			list_remove (&w->elem);
+			workqueue_check_idle (w->wq);
+		}
+		w->pending = false;
+		canceled = true;
+	}
+	intr_set_level (old_level);
+	return canceled;
+}
+
+/* Waits until WQ has no queued or running work.  Work queued on
+   WQ meanwhile is waited for too; delayed work whose delay has not
+   expired is not.  Must not be called from work running on WQ. */
+void
+flush_workqueue (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (wq != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (!list_empty (&wq->works) || wq->running > 0) {
+		struct waitq_elem waiter;
+
+		waitq_push (&wq->flushers, &waiter, thread_current ());
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* Removes and returns the first work item of the highest priority
+   nonempty queue, or returns a null pointer if there is none. */
+static struct work *
+work_take (void) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&workqueues); e != list_end (&workqueues);
+			e = list_next (e)) {
+		struct workqueue *wq = list_entry (e, struct workqueue, elem);
+		if (!list_empty (&wq->works)) {
+			struct work *w = list_entry (list_pop_front (&wq->works),
+					struct work, elem);
+			w->pending = false;
+			wq->running++;
+			return w;
+		}
+	}
+	return NULL;
+}
+
+/* Worker thread.  Runs queued work, each item at the priority of
+   its queue, and sleeps when there is none. */
+static void
+worker (void *aux UNUSED) {
+	for (;;) {
+		struct workqueue *wq;
+		struct work *w;
+
+		intr_disable ();
+		while ((w = work_take ()) == NULL) {
+			struct waitq_elem idle;
+
+			waitq_push (&idle_workers, &idle, thread_current ());
+			thread_block ();
+		}
+		wq = w->wq;
+		intr_enable ();
+
+		if (thread_get_priority () != wq->priority)
+			thread_set_priority (wq->priority);
+		w->func (w->aux);
+
+		/* W may already be queued again, or freed; use only WQ. */
+		intr_disable ();
+		wq->running--;
+		workqueue_check_idle (wq);
+		intr_enable ();
+	}
+}
+
+/* Wakes up the threads flushing WQ if it has no queued or running
+   work left. */
+static void
+workqueue_check_idle (struct workqueue *wq) {
+	struct waitq_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!list_empty (&wq->works) || wq->running > 0)
+		return;
+	while ((e = waitq_pop (&wq->flushers)) != NULL)
+		thread_unblock (e->thread);
+}
+
+/* Orders queues by descending priority. */
+static bool
+workqueue_higher (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct workqueue *a = list_entry (a_, struct workqueue, elem);
+	const struct workqueue *b = list_entry (b_, struct workqueue, elem);
+
+	return a->priority > b->priority;
+}
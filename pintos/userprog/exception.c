@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -143,9 +144,12 @@ page_fault (struct intr_frame *f) {
 
 #ifdef VM
 	/* For project 3 and later. */
+	uint64_t start = rdtsc ();
 	thread_current()->user_rsp = rrsp();
-	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
+	if (vm_try_handle_fault (f, fault_addr, user, write, not_present)) {
+		TRACE (TRACE_PAGE_FAULT, fault_addr, rdtsc () - start);
 		return;
+	}
 #endif
 
 	thread_current()->exit_status= -1;
@@ -0,0 +1,220 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Fast user-space mutexes.
+
+   A futex is just an int in user memory.  User code changes it
+   with atomic instructions and only calls into the kernel to
+   sleep until the value changes, or to wake up sleepers after
+   changing it, so an uncontended lock costs no system call.
+
+   Sleepers are kept in wait queues hashed by the physical
+   address of the int, so that every mapping of the same memory
+   finds the same queue.  While a thread sleeps on a futex, the
+   frame holding it is pinned, so the address stays valid.  A
+   queue exists only while somebody waits in it.  Interrupts are
+   off while the table is accessed.
+
+   Each process also lists its sleepers, so that they can be woken
+   up when it exits, see futex_wake_process(). */
+
+/* Number of hash buckets. */
+#define FUTEX_BUCKETS 64
+
+/* Threads waiting on one futex. */
+struct futex_queue {
+	uintptr_t key;              /* Physical address of the futex. */
+	struct waitq waiters;       /* Waiting threads. */
+	struct list_elem elem;      /* Element of hash bucket. */
+};
+
+/* A thread sleeping in futex_wait(). */
+struct futex_waiter {
+	struct waitq_elem elem;         /* Element of the queue's `waiters'. */
+	struct futex_queue *queue;      /* Queue it waits in. */
+	struct list_elem process_elem;  /* Element of its process's
+	                                   `futex_waiters'. */
+	struct futex_queue *dead;       /* Queue emptied by its wakeup, for
+	                                   it to free, or null. */
+};
+
+static struct list buckets[FUTEX_BUCKETS];
+
+/* Initializes the futex table. */
+void
+futex_init (void) {
+	int i;
+
+	for (i = 0; i < FUTEX_BUCKETS; i++)
+		list_init (&buckets[i]);
+}
+
+/* Returns the hash bucket for KEY. */
+static struct list *
+futex_bucket (uintptr_t key) {
+	return &buckets[hash_bytes (&key, sizeof key) % FUTEX_BUCKETS];
+}
+
+/* Returns the queue of the futex at physical address KEY, or a
+   null pointer if nobody waits on it. */
+static struct futex_queue *
+futex_lookup (uintptr_t key) {
+	struct list *bucket = futex_bucket (key);
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e)) {
+		struct futex_queue *q = list_entry (e, struct futex_queue, elem);
+		if (q->key == key)
+			return q;
+	}
+	return NULL;
+}
+
+/* Keeps the page holding user address UADDR in memory until
+   futex_unpin(), and returns the kernel virtual address of
+   UADDR, or a null pointer if UADDR is not mapped. */
+static int *
+futex_pin (int *uaddr) {
+	if (uaddr == NULL || !is_user_vaddr (uaddr)
+			|| (uintptr_t) uaddr % sizeof (int) != 0)
+		return NULL;
+#ifdef VM
+	return vm_pin_page (uaddr);
+#else
+	return pml4_get_page (thread_current ()->pml4, uaddr);
+#endif
+}
+
+/* Undoes futex_pin() of UADDR. */
+static void
+futex_unpin (int *uaddr UNUSED) {
+#ifdef VM
+	vm_unpin_page (uaddr);
+#endif
+}
+
+/* If the int at user address UADDR equals VAL, sleeps until
+   futex_wake() is called on it, or the process exits.  The test
+   and the sleep are atomic with respect to futex_wake().  Returns
+   0 after being woken, 1 if the value differed or the process is
+   exiting, or -1 if UADDR is not a valid, aligned user address. */
+int
+futex_wait (int *uaddr, int val) {
+	struct process *p = thread_current ()->process;
+	struct futex_queue *spare, *q;
+	struct futex_waiter waiter;
+	enum intr_level old_level;
+	int *kaddr;
+	int result = 1;
+
+	/* Allocate beforehand; malloc() may sleep.  Out of memory,
+	   return as if the value had changed and let the caller
+	   retry. */
+	spare = malloc (sizeof *spare);
+	if (spare == NULL)
+		return 1;
+	kaddr = futex_pin (uaddr);
+	if (kaddr == NULL) {
+		free (spare);
+		return -1;
+	}
+
+	waiter.dead = NULL;
+	old_level = intr_disable ();
+	if (*kaddr == val && !p->exiting) {
+		uintptr_t key = vtop (kaddr);
+
+		q = futex_lookup (key);
+		if (q == NULL) {
+			q = spare;
+			spare = NULL;
+			q->key = key;
+			waitq_init (&q->waiters);
+			list_push_back (futex_bucket (key), &q->elem);
+		}
+		waiter.queue = q;
+		waitq_push (&q->waiters, &waiter.elem, thread_current ());
+		list_push_back (&p->futex_waiters, &waiter.process_elem);
+		thread_block ();
+		result = 0;
+	}
+	intr_set_level (old_level);
+
+	futex_unpin (uaddr);
+	free (spare);
+	free (waiter.dead);
+	return result;
+}
+
+/* Wakes up to CNT threads sleeping on the int at user address
+   UADDR, highest priority first.  Returns the number of threads
+   woken, or -1 if UADDR is not a valid, aligned user address. */
+int
+futex_wake (int *uaddr, int cnt) {
+	struct futex_queue *q, *dead = NULL;
+	enum intr_level old_level;
+	int *kaddr;
+	int woken = 0;
+
+	kaddr = futex_pin (uaddr);
+	if (kaddr == NULL)
+		return -1;
+
+	old_level = intr_disable ();
+	q = futex_lookup (vtop (kaddr));
+	if (q != NULL) {
+		struct waitq_elem *e;
+
+		while (woken < cnt && (e = waitq_pop (&q->waiters)) != NULL) {
+			struct futex_waiter *w = waitq_entry (e, struct futex_waiter, elem);
+
+			list_remove (&w->process_elem);
+			thread_unblock (e->thread);
+			woken++;
+		}
+		if (waitq_empty (&q->waiters)) {
+			list_remove (&q->elem);
+			dead = q;
+		}
+	}
+	intr_set_level (old_level);
+
+	futex_unpin (uaddr);
+	free (dead);
+	thread_preempt ();
+	return woken;
+}
+
+/* Wakes up every thread of process P sleeping in futex_wait(),
+   because P is exiting.  Interrupts must be off. */
+void
+futex_wake_process (struct process *p) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!list_empty (&p->futex_waiters)) {
+		struct futex_waiter *w = list_entry (list_pop_front (&p->futex_waiters),
+				struct futex_waiter, process_elem);
+
+		waitq_remove (&w->elem);
+		if (waitq_empty (&w->queue->waiters)) {
+			list_remove (&w->queue->elem);
+			w->dead = w->queue;
+		}
+		thread_unblock (w->elem.thread);
+	}
+}
@@ -7,12 +7,15 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
+#include "userprog/futex.h"
+#include "devices/input.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -24,15 +27,38 @@
 #include "vm/vm.h"
 #endif
 
+static bool process_init (void);
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void **);
+static void process_thread_finish (void);
+static bool setup_thread_stack (int slot, struct intr_frame *if_);
+static void process_set_exiting (struct process *);
 
-/* General process initializer for initd and other process. */
-static void
+/* General process initializer for initd and other process.
+   Makes the running thread the leader of a new process.  Returns
+   false if memory runs out. */
+static bool
 process_init (void) {
 	struct thread *current = thread_current ();
+	struct process *p = malloc (sizeof *p);
+
+	if (p == NULL)
+		return false;
+	list_init (&p->threads);
+	p->live_threads = 1;
+	sema_init (&p->threads_sema, 0);
+	p->exiting = false;
+	p->stack_slots = 0;
+	memset (&p->threads_ru, 0, sizeof p->threads_ru);
+	lock_init (&p->fd_lock);
+	list_init (&p->futex_waiters);
+#ifdef VM
+	lock_init (&p->fault_lock);
+#endif
+	current->process = p;
+	return true;
 }
 
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
@@ -82,7 +108,8 @@ initd (void *f_name) {
 	lock_init(&open_lock);
 #endif
 
-	process_init ();
+	if (!process_init ())
+		PANIC("Fail to launch initd\n");
 
 	if (process_exec (f_name) < 0)
 		PANIC("Fail to launch initd\n");
@@ -171,6 +198,9 @@ __do_fork (void ** aux) {
 	memcpy (&if_, parent_if, sizeof (struct intr_frame));
 	if_.R.rax=0;
 
+	if (!process_init ())
+		goto error;
+
 	/* 2. Duplicate PT */
 	curr->pml4 = pml4_create();
 	if (curr->pml4 == NULL)
@@ -179,7 +209,7 @@ __do_fork (void ** aux) {
 	process_activate (curr);
 #ifdef VM
 	supplemental_page_table_init (&curr->spt);
-	if (!supplemental_page_table_copy (&curr->spt, &parent->spt))
+	if (!supplemental_page_table_copy (&curr->spt, &parent->leader->spt))
 		goto error;
 	curr->stack_floor=USER_STACK;
 #else
@@ -196,13 +226,19 @@ __do_fork (void ** aux) {
 	curr->parent = parent;
 	//curr->tf=if_;
 
-	for (int i = 0; i < parent->num_of_fd; i++){
-		if (parent->fd_table[i])
-			curr->fd_table[i] = file_duplicate(parent->fd_table[i]);
-	}
-	curr->num_of_fd = parent->num_of_fd;
+	/* Forked by a thread running on a thread stack, which the
+	   child, having only that thread, must not hand out again. */
+	if (parent->stack_slot >= 0)
+		curr->process->stack_slots = 1u << parent->stack_slot;
 
-	process_init ();
+	/* The parent's other threads may be opening or closing files. */
+	lock_acquire (&parent->process->fd_lock);
+	for (int i = 0; i < parent->leader->num_of_fd; i++){
+		if (parent->leader->fd_table[i])
+			curr->fd_table[i] = file_duplicate(parent->leader->fd_table[i]);
+	}
+	curr->num_of_fd = parent->leader->num_of_fd;
+	lock_release (&parent->process->fd_lock);
 
 	/* Finally, switch to the newly created process. */
 	if (succ)
@@ -222,6 +258,12 @@ process_exec (void *f_name) {
 	char file_name[100];
 	strlcpy(file_name, f_name, 100);
 	bool success;
+
+	/* The other threads of a multithreaded process would lose their
+	   address space under them. */
+	if (thread_current ()->leader != thread_current ()
+			|| thread_current ()->process->live_threads > 1)
+		return -1;
 	thread_current()->is_process_msg = true;
 
 
@@ -293,23 +335,25 @@ process_wait (tid_t child_tid) {
 	 * XXX:       implementing the process_wait. */
 
 	enum intr_level old_level;
+	struct thread* curr = thread_current();
+	int exit_status;
 	old_level = intr_disable ();
 
-	//child의 status를 ready로 바꿔주고 ready_list에 넣어줌 이건 해줘야함
+	/* The child stays in the tid table until it has been waited
+	   for, because it blocks on exit_sema before dying.  A child
+	   that was already waited for has its parent cleared. */
 	struct thread* child = get_thread(child_tid);
-	//child->status = THREAD_READY;
-	//thread_push_ready_list(child);
-	if (child -> parent != thread_current()){ return -1;}
-	if (child -> is_exit ) goto done;
-
-	intr_set_level(old_level);
-
-
-	//sema_down이 알아서 curr BLOCK으로 바꿔서 waiters에 넣어줌
-	thread_sema_down(&child->wait_sema);//부모가 아니라 자식의 sema여야함 -> 자식세마 웨이터에 부모넣기
-
+	if (child == NULL || child -> parent != curr){
+		intr_set_level(old_level);
+		return -1;
+	}
 
-	//pop child in child_list in parent
+	if (!child -> is_exit ){
+		intr_set_level(old_level);
+		//sema_down이 알아서 curr BLOCK으로 바꿔서 waiters에 넣어줌
+		thread_sema_down(&child->wait_sema);//부모가 아니라 자식의 sema여야함 -> 자식세마 웨이터에 부모넣기
+		intr_disable ();
+	}
 
 	/*
 	자원해제
@@ -317,30 +361,13 @@ process_wait (tid_t child_tid) {
 	1. exit, kill 후 바로 sema_up 해주기
 	2. 이 함수에서 sema_down이후로 intr_disable()
 	*/
-
-done:
-
-	old_level = intr_disable ();
-
-	struct thread* curr = thread_current();
-	if(!list_empty(&curr->child_list)){
-		struct thread* target_child= list_entry(list_front(&curr->child_list), struct thread, child_elem);
-		while (target_child->tid != child_tid){
-			if (&target_child->child_elem == list_end(&curr->child_list) ){
-				intr_set_level (old_level);
-				return -1;		
-			}
-			target_child=list_entry(list_next(&target_child->child_elem), struct thread, child_elem);
-		}
-		int exit_status=target_child->exit_status;
-		list_remove(&target_child->child_elem);
-		sema_up(&target_child->exit_sema);
-		intr_set_level (old_level);
-		
-		return exit_status;
-	}
+	exit_status=child->exit_status;
+	thread_reap_rusage (child);
+	list_remove(&child->child_elem);
+	child->parent = NULL;
+	sema_up(&child->exit_sema);
 	intr_set_level (old_level);
-	return -1;
+	return exit_status;
 }
 
 /* Exit the process. This function is called by thread_exit (). */
@@ -353,13 +380,43 @@ process_exit (void) {
 	 * TODO: We recommend you to implement process resource cleanup here. */
 	//print exit
 	curr->is_exit=1;
-	process_cleanup ();
 	if(!list_empty(&curr->child_list)){
 	for (struct list_elem* c = list_front(&curr->child_list); c != list_end(&curr->child_list); ){
 		struct thread* t = list_entry(c,struct thread, child_elem);
 		c = c->next;
 		sema_up(&t->exit_sema);
 	}}
+	if (curr->leader != curr) {
+		process_thread_finish ();
+		return;
+	}
+
+	/* The process ends with its last thread.  Unless the leader
+	   only ended itself with thread_exit(), the other threads are
+	   told to exit, which they do the next time they enter the
+	   kernel or are interrupted in user mode.  Then those never
+	   joined are let go. */
+	struct process *p = curr->process;
+	if (p != NULL) {
+		if (!curr->thread_exited) {
+			enum intr_level old_level = intr_disable ();
+			process_set_exiting (p);
+			intr_set_level (old_level);
+		}
+		while (p->live_threads > 1)
+			sema_down (&p->threads_sema);
+		while (!list_empty (&p->threads)) {
+			struct thread *t = list_entry (list_pop_front (&p->threads),
+					struct thread, thread_elem);
+			sema_up (&t->exit_sema);
+		}
+	}
+	process_cleanup ();
+	if (p != NULL) {
+		thread_merge_rusage ();
+		curr->process = NULL;
+		free (p);
+	}
 	
 	for (int i = 2; i < curr->num_of_fd; i++){
 		if (curr->fd_table[i])
@@ -411,6 +468,236 @@ process_activate (struct thread *next) {
 	tss_update (next);
 }
 
+/* User threads.
+
+   thread_create() starts another kernel thread in the calling
+   process.  It shares the process's page table, supplemental
+   page table and file descriptors, which stay in the leader,
+   and runs on a stack of its own.  Thread stacks are slots of
+   THREAD_STACK_PAGES pages, each with an unmapped guard page
+   below it, placed below the 1 MB the leader's stack may grow
+   to.  A slot keeps its pages once mapped, so the next thread to
+   get it reuses them.
+
+   A thread that exits stays around, holding its exit status,
+   until it is joined or the process ends.  The process ends when
+   its last thread does. */
+
+/* Maximum number of threads besides the leader. */
+#define THREAD_MAX 32
+
+/* Pages in a thread stack. */
+#define THREAD_STACK_PAGES 16
+
+/* Top of thread stack slot N. */
+#define THREAD_STACK_TOP(N) \
+	((uint8_t *) USER_STACK - (1 << 20) - PGSIZE \
+	 - (N) * (THREAD_STACK_PAGES + 1) * PGSIZE)
+
+/* Passed by process_thread_create() to start_thread(). */
+struct thread_start {
+	struct intr_frame if_;              /* User context to start in. */
+	struct thread *leader;              /* Leader of its process. */
+	int stack_slot;                     /* Its thread stack. */
+	struct semaphore started;           /* Upped once it is listed. */
+};
+
+/* Thread function that enters user mode as described by
+   START_, a struct thread_start. */
+static void
+start_thread (void *start_) {
+	struct thread_start *start = start_;
+	struct thread *curr = thread_current ();
+	struct intr_frame if_;
+	enum intr_level old_level;
+
+	memcpy (&if_, &start->if_, sizeof if_);
+	curr->leader = start->leader;
+	curr->process = start->leader->process;
+	curr->stack_slot = start->stack_slot;
+	curr->pml4 = curr->leader->pml4;
+	process_activate (curr);
+
+	old_level = intr_disable ();
+	list_push_back (&curr->process->threads, &curr->thread_elem);
+	intr_set_level (old_level);
+
+	sema_up (&start->started);
+	do_iret (&if_);
+	NOT_REACHED ();
+}
+
+/* Starts a thread in the current process that calls ENTRY with
+   ARG0 and ARG1 as its first two arguments.  IF_ is the calling
+   thread's user context, whose segment registers and flags it
+   inherits.  Returns the new thread's tid, or TID_ERROR if the
+   process is exiting, already has THREAD_MAX other threads or
+   memory runs out. */
+tid_t
+process_thread_create (void *entry, uint64_t arg0, uint64_t arg1,
+		struct intr_frame *if_) {
+	struct thread *curr = thread_current ();
+	struct process *p = curr->process;
+	struct thread_start start;
+	enum intr_level old_level;
+	int slot;
+	tid_t tid = TID_ERROR;
+
+	old_level = intr_disable ();
+	for (slot = 0; slot < THREAD_MAX; slot++)
+		if ((p->stack_slots & (1u << slot)) == 0)
+			break;
+	if (p->exiting || slot == THREAD_MAX) {
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+	p->stack_slots |= 1u << slot;
+	p->live_threads++;
+	intr_set_level (old_level);
+
+	memcpy (&start.if_, if_, sizeof start.if_);
+	start.if_.rip = (uint64_t) entry;
+	start.if_.R.rdi = arg0;
+	start.if_.R.rsi = arg1;
+	start.leader = curr->leader;
+	start.stack_slot = slot;
+	sema_init (&start.started, 0);
+
+	if (setup_thread_stack (slot, &start.if_))
+		tid = thread_create (curr->name, thread_get_priority (),
+				start_thread, &start);
+	if (tid == TID_ERROR) {
+		old_level = intr_disable ();
+		p->stack_slots &= ~(1u << slot);
+		p->live_threads--;
+		sema_up (&p->threads_sema);
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
+	sema_down (&start.started);
+	return tid;
+}
+
+/* Waits for thread TID of the current process to exit and
+   returns the status it passed to thread_exit(), or -1 if it
+   ended otherwise.  Returns -1 immediately if TID is the calling
+   thread, the leader or no thread of the process, if it has
+   already been joined, or if the process is exiting. */
+int
+process_thread_join (tid_t tid) {
+	struct thread *curr = thread_current ();
+	struct thread *t = NULL;
+	struct list_elem *e;
+	enum intr_level old_level;
+	int status;
+
+	old_level = intr_disable ();
+	for (e = list_begin (&curr->process->threads);
+			e != list_end (&curr->process->threads); e = list_next (e)) {
+		struct thread *cand = list_entry (e, struct thread, thread_elem);
+		if (cand->tid == tid) {
+			t = cand;
+			break;
+		}
+	}
+	if (t == NULL || t == curr || t->joined || curr->process->exiting) {
+		intr_set_level (old_level);
+		return -1;
+	}
+	t->joined = true;
+	intr_set_level (old_level);
+
+	sema_down (&t->wait_sema);
+
+	/* Woken up because the process is exiting, or T exited with
+	   it: the leader lets T go. */
+	old_level = intr_disable ();
+	if (curr->process->exiting) {
+		intr_set_level (old_level);
+		return -1;
+	}
+	status = t->exit_status;
+	list_remove (&t->thread_elem);
+	sema_up (&t->exit_sema);
+	intr_set_level (old_level);
+	return status;
+}
+
+/* Marks process P as exiting and wakes up its threads that sleep
+   until some other thread acts, in futex_wait(), thread_join() or
+   a console read, so that they notice and exit too.  Threads that
+   sleep for a bounded time are left to wake up on their own.
+   Interrupts must be off. */
+static void
+process_set_exiting (struct process *p) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	p->exiting = true;
+	futex_wake_process (p);
+	for (e = list_begin (&p->threads); e != list_end (&p->threads);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, thread_elem);
+		if (t->joined)
+			sema_up (&t->wait_sema);
+	}
+	input_wake ();
+}
+
+/* Ends the current thread with STATUS, for thread_join().  The
+   process goes on if it has other threads. */
+void
+process_thread_exit (int status) {
+	struct thread *curr = thread_current ();
+
+	curr->exit_status = status;
+	curr->thread_exited = true;
+	thread_exit ();
+}
+
+/* Ends the current thread if its process is exiting.  Called on
+   the way back to user mode. */
+void
+process_check_exit (void) {
+	if (thread_current ()->process->exiting) {
+		intr_enable ();
+		thread_exit ();
+	}
+}
+
+/* Does the part of process_exit() for a thread other than the
+   leader.  Ending in any way but through thread_exit() ends the
+   whole process, with the thread's exit status. */
+static void
+process_thread_finish (void) {
+	struct thread *curr = thread_current ();
+	struct thread *leader = curr->leader;
+	struct process *p = curr->process;
+	enum intr_level old_level;
+
+	/* Leave the address space, which the leader destroys. */
+	curr->pml4 = NULL;
+	pml4_activate (NULL);
+	palloc_free_page (curr->fd_table);
+
+	thread_merge_rusage ();
+
+	old_level = intr_disable ();
+	if (!curr->thread_exited && !p->exiting) {
+		process_set_exiting (p);
+		leader->exit_status = curr->exit_status;
+	}
+	p->stack_slots &= ~(1u << curr->stack_slot);
+	p->live_threads--;
+	sema_up (&p->threads_sema);
+	sema_up (&curr->wait_sema);
+	intr_set_level (old_level);
+
+	/* Wait to be joined, or let go by the leader. */
+	sema_down (&curr->exit_sema);
+}
+
 /* We load ELF binaries.  The following definitions are taken
  * from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -799,6 +1086,27 @@ setup_stack (struct intr_frame *if_) {
 	return success;
 }
 
+/* Maps the top page of thread stack SLOT, unless it is mapped
+ * from an earlier thread, and points IF_'s rsp at it. */
+static bool
+setup_thread_stack (int slot, struct intr_frame *if_) {
+	uint8_t *upage = THREAD_STACK_TOP (slot) - PGSIZE;
+	uint8_t *kpage;
+
+	if (pml4_get_page (thread_current ()->pml4, upage) == NULL) {
+		kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+		if (kpage == NULL)
+			return false;
+		if (!install_page (upage, kpage, true)) {
+			palloc_free_page (kpage);
+			return false;
+		}
+	}
+	/* As if called: the return address would be at rsp. */
+	if_->rsp = (uint64_t) THREAD_STACK_TOP (slot) - sizeof (void *);
+	return true;
+}
+
 /* Adds a mapping from user virtual address UPAGE to kernel
  * virtual address KPAGE to the page table.
  * If WRITABLE is true, the user process may modify the page;
@@ -917,4 +1225,27 @@ setup_stack (struct intr_frame *if_) {
 	}
 	return success;
 }
+
+/* Registers the pages of thread stack SLOT not registered by an
+ * earlier thread, to be claimed on first touch, and points IF_'s
+ * rsp at its top. */
+static bool
+setup_thread_stack (int slot, struct intr_frame *if_) {
+	struct thread *leader = thread_current ()->leader;
+	struct lock *fault_lock = &thread_current ()->process->fault_lock;
+	uint8_t *top = THREAD_STACK_TOP (slot);
+	bool success = true;
+
+	lock_acquire (fault_lock);
+	for (int i = 1; i <= THREAD_STACK_PAGES && success; i++)
+		if (spt_find_page (&leader->spt, top - i * PGSIZE) == NULL)
+			success = vm_alloc_page_with_initializer (VM_ANON,
+					top - i * PGSIZE, true, NULL, NULL);
+	lock_release (fault_lock);
+
+	/* As if called: the return address would be at rsp. */
+	if (success)
+		if_->rsp = (uint64_t) top - sizeof (void *);
+	return success;
+}
 #endif /* VM */
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/trace.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
@@ -11,7 +12,11 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "filesys/file.h"
+#include "filesys/directory.h"
 #include "userprog/process.h"
+#include "userprog/futex.h"
+#include "devices/input.h"
+#include <futex.h>
 
 #include "include/lib/string.h"
 #include "vm/vm.h"
@@ -35,9 +40,16 @@ int64_t sys_write (uint64_t* );
 int64_t sys_mmap (uint64_t* );
 void sys_seek (uint64_t*);
 void sys_munmap (uint64_t*);
+int64_t sys_schedstat (uint64_t*);
+int64_t sys_getrusage (uint64_t*);
+int64_t sys_futex (uint64_t*);
+int64_t sys_thread_create (uint64_t*);
+int64_t sys_thread_join (uint64_t*);
+void sys_thread_exit (uint64_t*);
 int64_t sys_tell (uint64_t*);
 void sys_close (uint64_t*);
 struct file* get_file(int);
+static int file_io_user (struct file *, uint8_t *, unsigned, bool write);
 
 /* System call.
  *
@@ -63,6 +75,8 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	futex_init ();
 }
 
 /* The main system call interface */	
@@ -72,6 +86,7 @@ syscall_handler (struct intr_frame *f) {
 	if(!check_address(f->rsp)){
 		sys_exit_num(-1);
 	}
+	process_check_exit ();
 
 	/* Get arguments */
 	uint64_t args[7];
@@ -90,6 +105,7 @@ syscall_handler (struct intr_frame *f) {
 	Use int64_t for updating rax to match the type of ret in syscall.
 	*/
 	int64_t update;
+	TRACE (TRACE_SYSCALL_ENTER, args[0], 0);
 	//printf("syscall: rax:%d\n",f->R.rax);
 	switch (f->R.rax){
 		default:
@@ -154,6 +170,30 @@ syscall_handler (struct intr_frame *f) {
 		case SYS_MUNMAP:
 			sys_munmap(args);
 			break;
+		case SYS_SCHEDSTAT:
+			update = sys_schedstat(args);
+			f->R.rax = update;
+			break;
+		case SYS_GETRUSAGE:
+			update = sys_getrusage(args);
+			f->R.rax = update;
+			break;
+		case SYS_FUTEX:
+			update = sys_futex(args);
+			f->R.rax = update;
+			break;
+		case SYS_THREAD_CREATE:
+			args[4]=(uint64_t) f;
+			update = sys_thread_create(args);
+			f->R.rax = update;
+			break;
+		case SYS_THREAD_JOIN:
+			update = sys_thread_join(args);
+			f->R.rax = update;
+			break;
+		case SYS_THREAD_EXIT:
+			sys_thread_exit(args);
+			break;
 
 		/* For project2 Extra*/		
 		// case SYS_MOUNT
@@ -171,7 +211,8 @@ syscall_handler (struct intr_frame *f) {
 		*/
 
 	}
-	
+	TRACE (TRACE_SYSCALL_EXIT, args[0], f->R.rax);
+	process_check_exit ();
 }
 
 int
@@ -268,7 +309,9 @@ extra 짤 때, 0부터 생성하고 뒷단에서 +-2 처리해주도록 변경
 int64_t
 sys_open (uint64_t* args) {
     const char* name = (const char *) args[1];
-    struct thread* curr = thread_current();
+    struct thread* curr = thread_current()->leader;
+    struct lock* fd_lock = &thread_current()->process->fd_lock;
+    int fd = -1;
 
     //ASSERT(curr->num_of_fd != FD_TABLE_SIZE); // If error, increase the number of entry in thread.h
     if(!check_address(name)) sys_exit_num(-1);
@@ -280,27 +323,41 @@ sys_open (uint64_t* args) {
 	// 	file_deny_write(file);
 	// }
 
-	if (curr->num_of_fd == FD_TABLE_SIZE) return -1;
-
+	/* Copy NAME in first: user memory must not fault while
+	   open_lock is held.  A name too long to fit stays too long
+	   for filesys_open(). */
+	char kname[NAME_MAX + 2];
+	strlcpy(kname, name, sizeof kname);
+
+	/* The table is shared by the threads of the process. */
+	lock_acquire(fd_lock);
+	if (curr->num_of_fd == FD_TABLE_SIZE) {
+		lock_release(fd_lock);
+		return -1;
+	}
 	lock_acquire(&open_lock);
-	struct file* open_file = filesys_open(name);
+	struct file* open_file = filesys_open(kname);
+	if (open_file != NULL && !strcmp(kname,curr->name))
+		file_deny_write(open_file);
 	lock_release(&open_lock);
-
-
-    if (open_file == NULL) return -1;
-
-	if(!strcmp(name,curr->name)){file_deny_write(open_file);}
-    curr->fd_table[curr->num_of_fd] = open_file;
-    curr->num_of_fd++;
-    return curr->num_of_fd-1;
+	if (open_file != NULL) {
+		fd = curr->num_of_fd++;
+		curr->fd_table[fd] = open_file;
+	}
+	lock_release(fd_lock);
+    return fd;
 }
 
 int64_t
 sys_filesize (uint64_t* args) {
 	int fd = (int) args[1];
+	struct lock* fd_lock = &thread_current()->process->fd_lock;
+	lock_acquire(fd_lock);
 	struct file* file = get_file(fd);
 	ASSERT(file != 0);
-	return (int64_t) file_length(file);
+	int64_t length = file_length(file);
+	lock_release(fd_lock);
+	return length;
 }
 
 
@@ -312,37 +369,43 @@ sys_read (uint64_t* args) {
 	uint8_t* buffer = (uint8_t*) args[2]; // 얘 init 안해줘도 되나
 	unsigned size = (unsigned) args[3];
 	int read_byte = 0;
+	int next_key;
 	uint8_t key;
 
 	if (!check_address(buffer)) sys_exit_num(-1); // Or return -1? Or put it in default
-	struct page* page= spt_find_page(&thread_current()->spt, pg_round_down(buffer));
+	struct page* page= spt_find_page(&thread_current()->leader->spt, pg_round_down(buffer));
 	if( page !=NULL){
 		if(size!=0 && page->writable==false){  sys_exit_num(-1); }
 	}
 
 	struct file* file;
-	if(fd<0||fd>=thread_current()->num_of_fd){sys_exit_num(-1);}
+	if(fd<0||fd>=thread_current()->leader->num_of_fd){sys_exit_num(-1);}
 	switch (fd){
 		case 0:
-			key = input_getc();
-			buffer[read_byte] = key;
+			/* Woken up empty-handed if the process exits. */
+			if ((next_key = input_getc_unless(&thread_current()->process->exiting)) < 0)
+				return -1;
+			buffer[read_byte] = next_key;
 			read_byte++;
 			while ((read_byte < size) && (!buffer_empty())){ 
 				key = input_getc();
 				buffer[read_byte] = key;
 				read_byte++;
 			}
+			thread_current()->ru.read_bytes += read_byte;
 			return (int64_t) read_byte;
 
 		case 1:
 			return (int64_t) -1;
 
 		default:
+			lock_acquire(&thread_current()->process->fd_lock);
 			file = get_file(fd);
+			read_byte = file != NULL ? file_io_user(file, buffer, size, false) : -1;
+			lock_release(&thread_current()->process->fd_lock);
 			if (file == NULL) return -1;
-			lock_acquire(&open_lock);
-			read_byte = file_read(file, buffer, size);
-			lock_release(&open_lock);
+			if (read_byte < 0) sys_exit_num(-1);
+			thread_current()->ru.read_bytes += read_byte;
 			return (int64_t) read_byte;
 	}
 
@@ -385,7 +448,7 @@ sys_write (uint64_t* args) {
 	// */
 	int write_byte=0;
 	if (!check_address(buffer)) sys_exit_num(-1);
-	if(fd<0||fd>=thread_current()->num_of_fd){sys_exit_num(-1);}
+	if(fd<0||fd>=thread_current()->leader->num_of_fd){sys_exit_num(-1);}
 	
 	struct file* file;
 	long rest;
@@ -402,41 +465,99 @@ sys_write (uint64_t* args) {
 			putbuf (buffer, temp_size);
 			rest=rest-100;
 			}
+			thread_current()->ru.write_bytes += size;
 			return (int64_t) size;
 		default:
+			lock_acquire(&thread_current()->process->fd_lock);
 			file = get_file(fd);
-			if (file == NULL) 
-				return (int64_t) 0;
-			lock_acquire(&open_lock);
-			write_byte = file_write(file, buffer, size);
-			lock_release(&open_lock);
-			ASSERT(write_byte >= 0);
+			write_byte = file != NULL
+				? file_io_user(file, (uint8_t *) buffer, size, true) : 0;
+			lock_release(&thread_current()->process->fd_lock);
+			if (write_byte < 0) sys_exit_num(-1);
+			thread_current()->ru.write_bytes += write_byte;
 			return (int64_t) write_byte;
 	}
 }
 
+/* Moves SIZE bytes between FILE and user BUFFER, with
+   file_write() if WRITE, else with file_read().  Returns the
+   number of bytes moved, or -1 if BUFFER runs into memory the
+   process does not have.  The caller holds the process's fd_lock,
+   which keeps FILE open, and must release it before killing the
+   process for a bad buffer.
+
+   Since a fault takes the process's fault_lock, which is ordered
+   before open_lock, the buffer must not fault while open_lock is
+   held.  It is moved a page at a time, each page brought in and
+   pinned before open_lock is taken. */
+static int
+file_io_user (struct file *file, uint8_t *buffer, unsigned size, bool write) {
+	int total = 0;
+
+	while (size > 0) {
+		unsigned chunk = PGSIZE - pg_ofs (buffer);
+		int n;
+
+		if (chunk > size)
+			chunk = size;
+#ifdef VM
+		/* A first touch of the stack has to go through the fault
+		   handler to grow it. */
+		(void) *(volatile uint8_t *) buffer;
+		if (vm_pin_page (buffer) == NULL)
+			return -1;
+#endif
+		lock_acquire (&open_lock);
+		n = write ? file_write (file, buffer, chunk)
+			: file_read (file, buffer, chunk);
+		lock_release (&open_lock);
+#ifdef VM
+		vm_unpin_page (buffer);
+#endif
+		total += n;
+		if ((unsigned) n < chunk)
+			break;
+		buffer += chunk;
+		size -= chunk;
+	}
+	return total;
+}
+
 void
 sys_seek (uint64_t* args) {
 	int fd = (int) args[1];
 	unsigned position = (unsigned) args[2];
+	struct lock* fd_lock = &thread_current()->process->fd_lock;
+	lock_acquire(fd_lock);
 	struct file* file = get_file(fd);
 	file_seek(file, position);
+	lock_release(fd_lock);
 }
 
 int64_t
 sys_tell (uint64_t* args) {
 	int fd = (int) args[1];
+	struct lock* fd_lock = &thread_current()->process->fd_lock;
+	lock_acquire(fd_lock);
 	struct file* file = get_file(fd);
-	return file_tell(file);
+	int64_t position = file_tell(file);
+	lock_release(fd_lock);
+	return position;
 }
 
 void
 sys_close (uint64_t* args) {
    int fd = (int) args[1];
-   struct thread* curr= thread_current();
-   if(fd<2||fd>=curr->num_of_fd){sys_exit_num(-1);}
+   struct thread* curr= thread_current()->leader;
+   struct process* p = thread_current()->process;
+   if(fd<2){sys_exit_num(-1);}
+   /* Other threads of the process may be using the file. */
+   lock_acquire(&p->fd_lock);
    struct file* file = get_file(fd);
-   if(file==NULL){sys_exit_num(-1);}
+   if(file==NULL){lock_release(&p->fd_lock); sys_exit_num(-1);}
+   curr->fd_table[fd]=NULL;
+
+   lock_acquire(&p->fault_lock);
 
    if(!list_empty(&curr->mmap_info_list)){
    for (struct list_elem* c = list_front(&curr->mmap_info_list); c != list_end(&curr->mmap_info_list); ){
@@ -451,18 +572,23 @@ sys_close (uint64_t* args) {
          }
       }
    }}
-	thread_current()->fd_table[fd]=NULL;
+	lock_release(&p->fault_lock);
 	lock_acquire(&open_lock);
 	file_close(file);
 	lock_release(&open_lock);
+	lock_release(&p->fd_lock);
 }
 
-/* Get file pointer searching in the current threads fd_table */
+/* Get file pointer searching in the current process's fd_table,
+   or a null pointer if FD is not open.  The process's fd_lock must
+   be held for as long as the file is used, so that another thread
+   cannot close it meanwhile. */
 struct file*
 get_file(int fd){
-	ASSERT (thread_current()->num_of_fd != FD_TABLE_SIZE);
-	struct file* file = thread_current()->fd_table[fd];
-	return file;
+	struct thread* leader = thread_current()->leader;
+	ASSERT (lock_held_by_current_thread (&thread_current()->process->fd_lock));
+	if (fd < 0 || fd >= leader->num_of_fd) return NULL;
+	return leader->fd_table[fd];
 }
 int64_t
 sys_mmap(uint64_t* args) {
@@ -483,9 +609,7 @@ sys_mmap(uint64_t* args) {
 	if (length == 0) return 0;
 
 	//Check FD
-	if (fd>=FD_TABLE_SIZE) return 0; 
-
-	if (thread_current()->fd_table[fd] == NULL) return 0;
+	if (fd<0||fd>=FD_TABLE_SIZE) return 0; 
 
 	//Check offset
 	//if (offset > file_length(thread_current()->fd_table[fd])) return 0; //왜지?논리
@@ -495,8 +619,21 @@ sys_mmap(uint64_t* args) {
 	pgnum= length/PGSIZE;
 	if(length%PGSIZE){ pgnum = pgnum+1;}
 	// Check addr is already used
+	struct thread* leader = thread_current()->leader;
+	struct lock* fd_lock = &thread_current()->process->fd_lock;
+	struct lock* fault_lock = &thread_current()->process->fault_lock;
+	lock_acquire(fd_lock);
+	if (get_file(fd) == NULL) {
+		lock_release(fd_lock);
+		return 0;
+	}
+	lock_acquire(fault_lock);
 	for (int i = 0; i < pgnum; i++){
-		if ((spt_find_page(&thread_current()->spt, addr + PGSIZE*i)) !=NULL) return NULL;
+		if ((spt_find_page(&leader->spt, addr + PGSIZE*i)) !=NULL) {
+			lock_release(fault_lock);
+			lock_release(fd_lock);
+			return 0;
+		}
 	}
 
 	void* valid_addr = do_mmap(addr, length, writable, fd, offset);
@@ -506,14 +643,97 @@ sys_mmap(uint64_t* args) {
 		mmap_info->length = length;
 		mmap_info->fd =fd;
 		mmap_info->off = offset;
-		list_push_back(&thread_current()->mmap_info_list, &mmap_info->elem);
-		return (int64_t) valid_addr;
+		list_push_back(&leader->mmap_info_list, &mmap_info->elem);
 	}
-	return 0;
+	lock_release(fault_lock);
+	lock_release(fd_lock);
+	return (int64_t) valid_addr;
 }
 
 void
 sys_munmap(uint64_t* args) {
 	void* addr = (void*) args[1];
+	struct lock* fault_lock = &thread_current()->process->fault_lock;
+	lock_acquire(fault_lock);
 	do_munmap(addr);
+	lock_release(fault_lock);
+}
+
+int64_t
+sys_schedstat (uint64_t* args) {
+	struct sched_stat *stat = (struct sched_stat *) args[1];
+	if (!check_address(stat) || !check_address((char *) stat + sizeof *stat - 1))
+		sys_exit_num(-1);
+
+	struct sched_stat kstat;
+	thread_get_sched_stat (&kstat);
+	memcpy (stat, &kstat, sizeof kstat);
+	return 0;
+}
+
+/* Returns -1 if WHO is neither RUSAGE_SELF nor RUSAGE_CHILDREN. */
+int64_t
+sys_getrusage (uint64_t* args) {
+	int who = (int) args[1];
+	struct rusage *usage = (struct rusage *) args[2];
+	if (!check_address(usage) || !check_address((char *) usage + sizeof *usage - 1))
+		sys_exit_num(-1);
+	if (who != RUSAGE_SELF && who != RUSAGE_CHILDREN)
+		return -1;
+
+	struct rusage kusage;
+	thread_get_rusage (thread_current ()->leader, who, &kusage);
+	memcpy (usage, &kusage, sizeof kusage);
+	return 0;
+}
+
+/* FUTEX_WAIT returns 0 once woken, or -1 at once if *UADDR no
+   longer equals VAL.  FUTEX_WAKE returns the number of threads
+   woken.  A bad address kills the process. */
+int64_t
+sys_futex (uint64_t* args) {
+	int *uaddr = (int *) args[1];
+	int op = (int) args[2];
+	int val = (int) args[3];
+	int result;
+
+	if (!check_address(uaddr))
+		sys_exit_num(-1);
+
+	switch (op) {
+		case FUTEX_WAIT:
+			result = futex_wait (uaddr, val);
+			if (result < 0)
+				sys_exit_num(-1);
+			return result == 0 ? 0 : -1;
+		case FUTEX_WAKE:
+			result = futex_wake (uaddr, val);
+			if (result < 0)
+				sys_exit_num(-1);
+			return result;
+		default:
+			return -1;
+	}
+}
+
+/* Starts a thread at the user address in args[1], passing it
+   args[2] and args[3]; args[4] is the caller's intr_frame. */
+int64_t
+sys_thread_create (uint64_t* args) {
+	void *entry = (void *) args[1];
+	struct intr_frame *f = (struct intr_frame *) args[4];
+
+	if (!check_address(entry))
+		sys_exit_num(-1);
+	return process_thread_create (entry, args[2], args[3], f);
+}
+
+int64_t
+sys_thread_join (uint64_t* args) {
+	return process_thread_join ((tid_t) args[1]);
+}
+
+void
+sys_thread_exit (uint64_t* args) {
+	process_thread_exit ((int) args[1]);
 }
\ No newline at end of file
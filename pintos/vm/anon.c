@@ -93,5 +93,5 @@ anon_destroy (struct page *page) {
 	free(anon_page->aux);
 	ASSERT(thread_current()->pml4==anon_page->pml4);
 	memset(anon_page, 0, sizeof(struct anon_page));
-	struct hash_elem* e = hash_delete(&thread_current()->spt.hash, &page->elem);
+	struct hash_elem* e = hash_delete(&thread_current()->leader->spt.hash, &page->elem);
 }
@@ -108,7 +108,7 @@ file_backed_destroy (struct page *page) {
 	
 	free(file_page->aux);
 	memset(file_page, 0, sizeof(struct file_page));
-	struct hash_elem* e = hash_delete(&thread_current()->spt.hash, &page->elem);
+	struct hash_elem* e = hash_delete(&thread_current()->leader->spt.hash, &page->elem);
 }
 
 /* Do the mmap */
@@ -129,7 +129,7 @@ do_mmap (void *addr, size_t length, int writable,
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
 		void *aux = NULL;
 		struct lazy_args_set *aux_set = malloc(sizeof(struct lazy_args_set)); //??
-		aux_set->file=file_reopen(thread_current()->fd_table[fd]);
+		aux_set->file=file_reopen(thread_current()->leader->fd_table[fd]);
 		aux_set->ofs=ofs;
 		aux_set->page_read_bytes=page_read_bytes;
 		aux_set->page_zero_bytes=page_zero_bytes;
@@ -183,7 +183,7 @@ lazy_load_segment_file (struct page *page, void *aux) {
 void
 do_munmap (void *addr) {
 	//find information about the file
-	struct thread* curr = thread_current();
+	struct thread* curr = thread_current()->leader;
 	size_t length = 0;
 	int fd;
 	struct file* m_file;
@@ -75,6 +75,6 @@ uninit_destroy (struct page *page) {
 	free(uninit->aux);
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
-	struct hash_elem* e = hash_delete(&thread_current()->spt.hash, &page->elem);
+	struct hash_elem* e = hash_delete(&thread_current()->leader->spt.hash, &page->elem);
 	//ASSERT(e != NULL); //나중에~
 }
@@ -5,6 +5,7 @@
 #include "vm/inspect.h"
 
 #include "vm/uninit.h"
+#include "userprog/process.h"
 #include <intrinsic.h>
 
 
@@ -47,6 +48,8 @@ static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
 static bool vm_stack_growth (void * addr);
+static bool do_handle_fault (struct intr_frame *, void *addr, bool write,
+		bool not_present);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -56,7 +59,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		vm_initializer *init, void *aux) {
 //vm_alloc_page_with_initializer (VM_ANON, upage, writable, lazy_load_segment, aux)
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
-	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct supplemental_page_table *spt = &thread_current ()->leader->spt;
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
@@ -150,17 +153,24 @@ vm_get_victim (void) {
 	struct list_elem* c;
 	for (c = list_front(&frame_table); c != list_end(&frame_table); c = c->next){
 		victim = list_entry(c ,struct frame, elem);
+		if (victim->pin_cnt > 0) continue;
 		if (!pml4_is_accessed (thread_current()->pml4, victim->kva) && 
 			!pml4_is_dirty(thread_current()->pml4, victim->kva)) 
 				return victim;
 	}
 	for (c = list_front(&frame_table); c != list_end(&frame_table); c = c->next){
 		victim = list_entry(c ,struct frame, elem);
+		if (victim->pin_cnt > 0) continue;
 		if (!pml4_is_dirty(thread_current()->pml4, victim->kva)) 
 			return victim;
 	}
-	if (c==list_end(&frame_table)){ victim = list_entry(list_front(&frame_table) ,struct frame, elem); }
-		return victim;
+	/* Any frame that is not pinned. */
+	for (c = list_front(&frame_table); c != list_end(&frame_table); c = c->next){
+		victim = list_entry(c ,struct frame, elem);
+		if (victim->pin_cnt == 0)
+			return victim;
+	}
+	return NULL;
 }
 
 /* Evict one page and return the corresponding frame.
@@ -170,7 +180,9 @@ vm_evict_frame (void) {
 	struct frame *victim = vm_get_victim ();
 	/* TODO: swap out the victim and return the evicted frame. */
 	/*아래 코드 swap-out에서 할 수 있는지 고려*/
-	ASSERT(victim!=NULL);
+	/* Every frame may be pinned, for example by futex waiters. */
+	if (victim == NULL)
+		return NULL;
 	bool succ = swap_out(victim->page); //dirty bit 등 고려 안 함. 
 	if (!succ) return NULL;
 	// frame 내 정보 바꿈 생각 안 함. 
@@ -181,9 +193,9 @@ vm_evict_frame (void) {
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.
+ * and return it. That is, if the user pool memory is full, this function
+ * evicts the frame to get the available memory space.  Returns a null
+ * pointer if no frame can be evicted either.
  * palloc_get_page로 프레임 생성, 리턴
  * 불가시 evict(swap)
  * 
@@ -196,11 +208,14 @@ vm_get_frame (void) {
 
 	if(kva == NULL) { 
 		frame = vm_evict_frame(); 
+		if (frame == NULL)
+			return NULL;
 	}
 	else{
 		frame= malloc(sizeof(struct frame));
 		frame-> kva = kva;
 		frame-> page =NULL;
+		frame-> pin_cnt = 0;
 	}
 	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL);
@@ -270,7 +285,8 @@ vm_stack_growth (void * addr){
     return success;
 */
 
-	struct thread* curr = thread_current();
+	/* The stack that grows is the leader's. */
+	struct thread* curr = thread_current()->leader;
 	if(addr >= curr->stack_floor) return true;
     while (addr < curr->stack_floor){
         curr->stack_floor = curr->stack_floor - PGSIZE;
@@ -325,11 +341,29 @@ not_present page? 이건뭐야 True: not-present page, false: writing r/o page
 bool
 vm_try_handle_fault (struct intr_frame *f, void *addr,
 		bool user, bool write, bool not_present) {
-	struct supplemental_page_table *spt= &thread_current ()->spt;
+	if (is_kernel_vaddr(addr) || thread_current ()->process == NULL)
+		return false;
+
+	/* Threads of one process fault on the same pages. */
+	struct lock *fault_lock = &thread_current ()->process->fault_lock;
+	bool locked = !lock_held_by_current_thread (fault_lock);
+	if (locked)
+		lock_acquire (fault_lock);
+	bool success = do_handle_fault (f, addr, write, not_present);
+	if (locked)
+		lock_release (fault_lock);
+	return success;
+}
+
+/* Does the work of vm_try_handle_fault() with the process's
+   fault_lock held. */
+static bool
+do_handle_fault (struct intr_frame *f, void *addr, bool write,
+		bool not_present) {
+	struct supplemental_page_table *spt= &thread_current ()->leader->spt;
 	struct page *page = NULL;
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
-	if (is_kernel_vaddr(addr)) return false;
 	void* original_addr=addr;
  	addr = pg_round_down(addr);
 	//?? not_present는 왜 주어진거임?
@@ -352,10 +386,17 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 		// 원래있던코드
 		page = spt_find_page(spt, addr);
 		if (page != NULL) {
+			bool lazy = VM_TYPE (page->operations->type) == VM_UNINIT;
 			lock_acquire(&frame_lock);
 			bool success= vm_do_claim_page (page);
 			lock_release(&frame_lock);
 			if (write == true && page->writable == false) return false;
+			if (success) {
+				if (lazy)
+					thread_current ()->ru.lazy_faults++;
+				else
+					thread_current ()->ru.swap_faults++;
+			}
 			return success;
 		}
 		if (succ){
@@ -367,6 +408,8 @@ vm_try_handle_fault (struct intr_frame *f, void *addr,
 		lock_acquire(&frame_lock);
 		succ = vm_do_claim_page (page);
 		lock_release(&frame_lock);
+		if (succ)
+			thread_current ()->ru.stack_faults++;
 	}
 	if (write == true && page->writable == false) return false;
 	return succ;
@@ -388,7 +431,7 @@ bool
 vm_claim_page (void *va) {
 	struct page *page = NULL;
 	/* TODO: Fill this function */
-	page = spt_find_page(&thread_current()->spt, va);
+	page = spt_find_page(&thread_current()->leader->spt, va);
 	if(page == NULL) return false;
 	lock_acquire(&frame_lock);
 	bool success = vm_do_claim_page (page);
@@ -396,6 +439,52 @@ vm_claim_page (void *va) {
 	return success;
 }
 
+/* Brings the page holding user address UADDR into memory, if it
+   is not there yet, and keeps it from being evicted until
+   vm_unpin_page() is called.  Pins nest.  Returns the kernel
+   virtual address of UADDR, or a null pointer if UADDR is not
+   part of the current process's address space. */
+void *
+vm_pin_page (void *uaddr) {
+	struct thread *curr = thread_current ();
+	struct lock *fault_lock = &curr->process->fault_lock;
+	bool locked = !lock_held_by_current_thread (fault_lock);
+	void *upage = pg_round_down (uaddr);
+	struct page *page;
+	void *kva = NULL;
+
+	/* Claiming the page races with faults of the other threads. */
+	if (locked)
+		lock_acquire (fault_lock);
+	page = spt_find_page (&curr->leader->spt, upage);
+	if (page != NULL) {
+		lock_acquire (&frame_lock);
+		if (pml4_get_page (curr->pml4, upage) != NULL
+				|| vm_do_claim_page (page)) {
+			page->frame->pin_cnt++;
+			kva = (uint8_t *) page->frame->kva + pg_ofs (uaddr);
+		}
+		lock_release (&frame_lock);
+	}
+	if (locked)
+		lock_release (fault_lock);
+	return kva;
+}
+
+/* Releases a pin taken by vm_pin_page() on the page holding
+   user address UADDR. */
+void
+vm_unpin_page (void *uaddr) {
+	struct page *page = spt_find_page (&thread_current ()->leader->spt,
+			pg_round_down (uaddr));
+
+	ASSERT (page != NULL && page->frame != NULL);
+	lock_acquire (&frame_lock);
+	ASSERT (page->frame->pin_cnt > 0);
+	page->frame->pin_cnt--;
+	lock_release (&frame_lock);
+}
+
 static bool
 vm_install_page (void *upage, void *kpage, bool writable) {
 	struct thread *t = thread_current ();
@@ -412,6 +501,9 @@ static bool
 vm_do_claim_page (struct page *page) {
 	struct frame *frame = vm_get_frame ();
 
+	if (frame == NULL)
+		return false;
+
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;